@@ -0,0 +1,296 @@
+#include "camera.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <linux/videodev2.h>
+#include <opencv2/videoio.hpp>
+
+namespace {
+
+const int READ_TIMEOUT_MS = 1000; // この時間フレームが来なければ失敗とする
+
+// cv::VideoCapture (BGR)
+class OpenCvCamera : public Camera {
+public:
+    explicit OpenCvCamera(const CameraParams& params) : m_params(params), m_size(params.size) {}
+
+    const char* name() const override { return "opencv"; }
+
+    bool open() override {
+        if (!m_cap.open(m_params.device)) return false;
+        m_cap.set(cv::CAP_PROP_FRAME_WIDTH, m_params.size.width);
+        m_cap.set(cv::CAP_PROP_FRAME_HEIGHT, m_params.size.height);
+
+        // ドライバが近い解像度に変えることがあるので、実際の値を読む (返さないバックエンドなら1枚読んで見る)
+        m_size = cv::Size(static_cast<int>(m_cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                          static_cast<int>(m_cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        if (m_size.width <= 0 || m_size.height <= 0) {
+            cv::Mat first;
+            if (!m_cap.read(first) || first.empty()) {
+                std::cerr << "ERROR: Failed to read the first frame from the camera\n";
+                m_cap.release();
+                return false;
+            }
+            m_size = first.size();
+        }
+        if (m_size != m_params.size) {
+            std::cerr << "WARNING: Camera resolution is " << m_size.width << "x" << m_size.height
+                      << " (requested " << m_params.size.width << "x" << m_params.size.height << ")\n";
+        }
+        // スロットは実際の解像度で確保する (違う大きさだと read() のたびに確保し直しになる)
+        if (!m_pool || m_pool_size != m_size) {
+            m_pool.reset(new FramePool(m_params.buffer_count, m_size, CV_8UC3));
+            m_pool_size = m_size;
+        }
+        return true;
+    }
+
+    bool read(FramePool::Handle& frame, Clock::time_point& stamp) override {
+        if (!m_pool) return false;
+        while (!(frame = m_pool->acquire())) {
+            // 空きスロットが無い (通常は起きない)。カメラを止めないよう1枚読み捨てる
+            if (!m_cap.grab()) return false;
+        }
+        m_cap.read(frame.image());
+        stamp = Clock::now();
+        if (frame.image().empty()) {
+            frame.reset();
+            return false;
+        }
+        return true;
+    }
+
+    bool set_frame_rate(int fps) override { return m_cap.set(cv::CAP_PROP_FPS, fps); }
+
+    void close() override { m_cap.release(); }
+
+    cv::Size size() const override { return m_size; }
+    bool gray() const override { return false; }
+
+private:
+    CameraParams m_params;
+    cv::VideoCapture m_cap;
+    cv::Size m_size;      // open() で読んだ実際の解像度
+    cv::Size m_pool_size; // m_pool のスロットの大きさ
+    std::unique_ptr<FramePool> m_pool;
+};
+
+// V4L2 の mmap バッファ。Y 面をそのまま cv::Mat で包む
+class V4l2Camera : public Camera {
+public:
+    explicit V4l2Camera(const CameraParams& params) : m_params(params) {}
+    ~V4l2Camera() override { close(); }
+
+    const char* name() const override { return "v4l2"; }
+
+    bool open() override {
+        if (!m_buffers.empty()) {
+            // 前に開いたときの Handle がまだ残っていて、その mmap を外せていない
+            std::cerr << "ERROR: Camera frames from the previous open are still in use\n";
+            return false;
+        }
+        std::string path = "/dev/video" + std::to_string(m_params.device);
+        m_fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+        if (m_fd < 0) {
+            std::cerr << "ERROR: Could not open " << path << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+
+        v4l2_capability cap{};
+        if (xioctl(VIDIOC_QUERYCAP, &cap) < 0 || !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)
+            || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+            std::cerr << "ERROR: " << path << " does not support streaming capture\n";
+            return false;
+        }
+        if (!set_format() || !map_buffers()) return false;
+        set_frame_rate(m_params.fps); // 対応していないドライバもあるので失敗は無視する
+
+        // すべてのバッファをドライバに渡してから取得を始める
+        for (size_t i = 0; i < m_buffers.size(); ++i) {
+            if (!queue(i)) return false;
+        }
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (xioctl(VIDIOC_STREAMON, &type) < 0) {
+            std::cerr << "ERROR: VIDIOC_STREAMON failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        m_streaming = true;
+        return true;
+    }
+
+    bool read(FramePool::Handle& frame, Clock::time_point& stamp) override {
+        v4l2_buffer buf{};
+        while (true) {
+            pollfd pfd{m_fd, POLLIN, 0};
+            if (poll(&pfd, 1, READ_TIMEOUT_MS) <= 0) return false;
+
+            buf = v4l2_buffer{};
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            if (xioctl(VIDIOC_DQBUF, &buf) < 0) {
+                if (errno == EAGAIN) continue;
+                return false;
+            }
+
+            frame = m_pool->acquire(buf.index);
+            if (!frame) { // 貸し出し中のバッファが返ってくることは無いはず
+                queue(buf.index);
+                continue;
+            }
+            if (!(buf.flags & V4L2_BUF_FLAG_ERROR)) break;
+            frame.reset(); // 壊れたフレームはすぐにドライバに返す
+        }
+
+        // ドライバのタイムスタンプ (CLOCK_MONOTONIC = steady_clock と同じ基準) を使う
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+            stamp = Clock::time_point(std::chrono::seconds(buf.timestamp.tv_sec)
+                                      + std::chrono::microseconds(buf.timestamp.tv_usec));
+        } else {
+            stamp = Clock::now();
+        }
+        return true;
+    }
+
+    // 取得中でも VIDIOC_S_PARM で変えられるドライバが多い (変えられなければ元の速さのまま)
+    bool set_frame_rate(int fps) override {
+        v4l2_streamparm parm{};
+        parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        parm.parm.capture.timeperframe.numerator = 1;
+        parm.parm.capture.timeperframe.denominator = static_cast<uint32_t>(fps);
+        return xioctl(VIDIOC_S_PARM, &parm) == 0;
+    }
+
+    void close() override {
+        if (m_fd < 0) return;
+        if (m_streaming.exchange(false)) {
+            v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            xioctl(VIDIOC_STREAMOFF, &type);
+        }
+        // 貸し出し中の Handle の画像はまだ mmap を指しているので、全部返されるまで外さない
+        // (残っていれば最後に返された Handle の queue() で外す。m_pool も Handle のために残す)
+        std::lock_guard<std::mutex> lock(m_release_mutex);
+        ::close(m_fd);
+        m_fd = -1;
+        if (!m_pool || m_pool->in_use() == 0) unmap_buffers();
+    }
+
+    cv::Size size() const override { return m_size; }
+    bool gray() const override { return true; }
+
+private:
+    struct Buffer {
+        void* start;
+        size_t length;
+    };
+
+    int xioctl(unsigned long request, void* arg) {
+        int result;
+        do {
+            result = ioctl(m_fd, request, arg);
+        } while (result < 0 && errno == EINTR);
+        return result;
+    }
+
+    // 先頭に Y 面が連続して並ぶ形式を順に試す
+    bool set_format() {
+        const uint32_t formats[] = {V4L2_PIX_FMT_GREY, V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_NV12};
+        for (uint32_t format : formats) {
+            v4l2_format fmt{};
+            fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            fmt.fmt.pix.width = m_params.size.width;
+            fmt.fmt.pix.height = m_params.size.height;
+            fmt.fmt.pix.pixelformat = format;
+            fmt.fmt.pix.field = V4L2_FIELD_NONE;
+            if (xioctl(VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != format) continue;
+
+            m_size = cv::Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+            m_stride = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : fmt.fmt.pix.width;
+            if (m_size != m_params.size) {
+                std::cerr << "WARNING: Camera resolution is " << m_size.width << "x" << m_size.height
+                          << " (requested " << m_params.size.width << "x" << m_params.size.height << ")\n";
+            }
+            return true;
+        }
+        std::cerr << "ERROR: Camera supports none of GREY/YUV420/NV12 (try --camera=opencv)\n";
+        return false;
+    }
+
+
+    bool map_buffers() {
+        v4l2_requestbuffers req{};
+        req.count = static_cast<uint32_t>(m_params.buffer_count);
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+            std::cerr << "ERROR: VIDIOC_REQBUFS failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+
+        std::vector<cv::Mat> slots;
+        for (uint32_t i = 0; i < req.count; ++i) {
+            v4l2_buffer buf{};
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = i;
+            if (xioctl(VIDIOC_QUERYBUF, &buf) < 0) return false;
+            void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, buf.m.offset);
+            if (start == MAP_FAILED) {
+                std::cerr << "ERROR: mmap of capture buffer failed: " << std::strerror(errno) << "\n";
+                return false;
+            }
+            m_buffers.push_back({start, buf.length});
+            // Y 面 (バッファの先頭) をコピーせずに包む
+            slots.emplace_back(m_size.height, m_size.width, CV_8UC1, start, m_stride);
+        }
+        m_pool.reset(new FramePool(std::move(slots), [this](size_t index) { queue(index); }));
+        return true;
+    }
+
+    void unmap_buffers() {
+        for (Buffer& buffer : m_buffers) munmap(buffer.start, buffer.length);
+        m_buffers.clear();
+    }
+
+    // バッファをドライバに返す (Handle が破棄されたスレッドから呼ばれる)
+    // close() の後なら、最後の1枚が返されたところで mmap を外す
+    bool queue(size_t index) {
+        std::lock_guard<std::mutex> lock(m_release_mutex);
+        if (m_fd < 0) {
+            if (m_pool && m_pool->in_use() == 0) unmap_buffers();
+            return false;
+        }
+        if (index >= m_buffers.size()) return false;
+        v4l2_buffer buf{};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = static_cast<uint32_t>(index);
+        return xioctl(VIDIOC_QBUF, &buf) == 0;
+    }
+
+    CameraParams m_params;
+    int m_fd = -1;
+    std::atomic<bool> m_streaming{false};
+    cv::Size m_size;
+    size_t m_stride = 0;
+    std::mutex m_release_mutex; // close() と queue() (Handle を返したスレッド) の間で m_fd と m_buffers を守る
+    std::vector<Buffer> m_buffers;
+    std::unique_ptr<FramePool> m_pool;
+};
+
+}
+
+std::unique_ptr<Camera> make_camera(const CameraParams& params) {
+    if (params.backend == "opencv") return std::unique_ptr<Camera>(new OpenCvCamera(params));
+    if (params.backend == "v4l2") return std::unique_ptr<Camera>(new V4l2Camera(params));
+    return nullptr;
+}
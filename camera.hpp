@@ -0,0 +1,57 @@
+#pragma once
+// カメラ (フレームの取得)
+//
+// 取得した画像は FramePool の Handle で渡すので、キューを通しても画素はコピーされない。
+// CameraParams::backend で選ぶ:
+//   "opencv" : cv::VideoCapture (従来どおり。BGR で出てくる。どのカメラでも動く)
+//   "v4l2"   : V4L2 の mmap バッファを直接使う。GREY / YUV420 / NV12 で取り、Y (輝度) 面だけを
+//              コピー無しで cv::Mat (CV_8UC1) として渡す。BGR への変換もグレースケール化も要らない。
+//              解像度はドライバ側 (Raspberry Pi の ISP など) で縮小させる。
+//              libcamera のカメラは libcamerify (v4l2-compat) 経由で使う。
+// read() は1つのスレッド (キャプチャ) から呼ぶこと。
+// Handle はカメラ (Camera のオブジェクト) より先に破棄すること。close() の後に残っているのはよい。
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "frame_pool.hpp"
+
+// カメラ設定
+struct CameraParams {
+    std::string backend = "opencv";  // "opencv" または "v4l2"
+    int device = 0;                  // /dev/videoN の N
+    cv::Size size{640, 480};         // 要求する解像度 (ドライバが近い値に変えることがある)
+    int fps = 30;                    // 要求するフレームレート (v4l2 のみ)
+    size_t buffer_count = 4;         // 使い回すフレームバッファの数 (キャプチャ中・キュー内・検出中 + 予備1)
+};
+
+class Camera {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~Camera() = default;
+
+    virtual const char* name() const = 0;
+
+    // カメラを開いて取得を始める。失敗したら false
+    virtual bool open() = 0;
+    // 次のフレームを待って frame に入れる。stamp は撮影された (分かれば露光の) 時刻
+    // カメラが止まった (しばらくフレームが来ない・読めない) ら false (frame は空)
+    virtual bool read(FramePool::Handle& frame, Clock::time_point& stamp) = 0;
+    // 取得中にフレームレートを変える (read() と同じスレッドから呼ぶ)。できなければ false
+    virtual bool set_frame_rate(int fps) = 0;
+    // 取得を止める。貸し出し中の Handle の画像は、その Handle を破棄するまで読める
+    // (v4l2 は最後の Handle が返されたときに mmap を外す)
+    virtual void close() = 0;
+
+    // 実際の解像度 (open() の後)
+    virtual cv::Size size() const = 0;
+    // 画像がグレースケール (CV_8UC1) なら true、BGR (CV_8UC3) なら false
+    virtual bool gray() const = 0;
+};
+
+// params.backend のカメラを作る。知らない名前なら nullptr
+std::unique_ptr<Camera> make_camera(const CameraParams& params);
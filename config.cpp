@@ -0,0 +1,168 @@
+#include "config.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return std::string();
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+}
+
+bool Config::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR: Could not open config file [" << path << "]\n";
+        return false;
+    }
+    m_path = path;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        std::string key = equals == std::string::npos ? std::string() : trim(line.substr(0, equals));
+        if (key.empty()) {
+            std::cerr << "ERROR: " << path << ":" << line_no << ": expected <key> = <value>\n";
+            return false;
+        }
+        m_values[key] = trim(line.substr(equals + 1)); // 同じキーが2回あれば後の方
+    }
+    return true;
+}
+
+const std::string* Config::find(const std::string& key) const {
+    auto it = m_values.find(key);
+    if (it == m_values.end()) return nullptr;
+    m_used.insert(key);
+    return &it->second;
+}
+
+void Config::warn(const std::string& key, const std::string& message) const {
+    if (!m_warned.insert(key).second) return; // 同じキーは1回だけ
+    std::cerr << "WARNING: " << m_path << ": " << key << " = " << m_values.at(key) << " " << message << "\n";
+}
+
+void Config::error(const std::string& key, const std::string& message) const {
+    m_has_errors = true;
+    if (!m_warned.insert(key).second) return; // 同じキーは1回だけ
+    std::cerr << "ERROR: " << m_path << ": " << key << " = " << m_values.at(key) << " " << message << "\n";
+}
+
+std::string Config::get_string(const std::string& key, const std::string& fallback) const {
+    const std::string* value = find(key);
+    return value ? *value : fallback;
+}
+
+int Config::get_int(const std::string& key, int fallback) const {
+    const std::string* value = find(key);
+    if (!value) return fallback;
+    char* end = nullptr;
+    long parsed = std::strtol(value->c_str(), &end, 10);
+    if (value->empty() || *end != '\0') {
+        warn(key, "is not an integer, using " + std::to_string(fallback));
+        return fallback;
+    }
+    return static_cast<int>(parsed);
+}
+
+int Config::get_int(const std::string& key, int fallback, int min) const {
+    int value = get_int(key, fallback);
+    if (value >= min) return value;
+    error(key, "must be at least " + std::to_string(min));
+    return fallback;
+}
+
+float Config::get_float(const std::string& key, float fallback) const {
+    const std::string* value = find(key);
+    if (!value) return fallback;
+    char* end = nullptr;
+    float parsed = std::strtof(value->c_str(), &end);
+    if (value->empty() || *end != '\0') {
+        std::ostringstream message;
+        message << "is not a number, using " << fallback;
+        warn(key, message.str());
+        return fallback;
+    }
+    return parsed;
+}
+
+bool Config::get_bool(const std::string& key, bool fallback) const {
+    const std::string* value = find(key);
+    if (!value) return fallback;
+    if (*value == "true" || *value == "yes" || *value == "on" || *value == "1") return true;
+    if (*value == "false" || *value == "no" || *value == "off" || *value == "0") return false;
+    warn(key, std::string("is not true/false, using ") + (fallback ? "true" : "false"));
+    return fallback;
+}
+
+std::vector<std::string> Config::unused_keys() const {
+    std::vector<std::string> keys;
+    for (const auto& entry : m_values) {
+        if (m_used.count(entry.first) == 0) keys.push_back(entry.first);
+    }
+    return keys;
+}
+
+// --- コマンドライン引数 ---
+
+std::string arg_value(int argc, char** argv, const std::string& prefix, const std::string& fallback) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, prefix.size(), prefix) == 0) return arg.substr(prefix.size());
+    }
+    return fallback;
+}
+
+int arg_value(int argc, char** argv, const std::string& prefix, int fallback) {
+    std::string value = arg_value(argc, argv, prefix, std::string());
+    if (value.empty()) return fallback;
+    char* end = nullptr;
+    long parsed = std::strtol(value.c_str(), &end, 10);
+    if (*end != '\0') {
+        std::cerr << "WARNING: " << prefix << value << " is not an integer, using " << fallback << "\n";
+        return fallback;
+    }
+    return static_cast<int>(parsed);
+}
+
+bool has_arg(int argc, char** argv, const std::string& flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (flag == argv[i]) return true;
+    }
+    return false;
+}
+
+bool check_args(int argc, char** argv, const std::vector<std::string>& known) {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) continue; // 位置引数 (bench の動画など)
+        bool found = false;
+        for (const std::string& name : known) {
+            bool with_value = !name.empty() && name.back() == '=';
+            if (with_value ? arg.compare(0, name.size(), name) == 0 : arg == name) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            std::cerr << "ERROR: Unknown option [" << arg << "]\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,58 @@
+#pragma once
+// 設定ファイル (調整値を再コンパイルせずに変えるため)
+//
+// 1行に「キー = 値」。# から後はコメント。例:
+//   detector = lbp
+//   pan_min_pulse = 1050   # 左の端 (これ以上回すと当たる)
+// 書かれていないキーはコードの既定値 (XxxParams の値) を使う。コマンドライン引数 (--detector= など) は設定ファイルより優先する。
+// 読まれなかったキー (綴りの間違い・別のモードでしか使わないもの) は unused_keys() で分かる。
+// コマンドライン引数も arg_value() でここから読み、知らない引数は check_args() で弾く。
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class Config {
+public:
+    // path を読み込む。開けないか、書式が間違っていれば false (エラーを表示する)
+    bool load(const std::string& path);
+
+    bool has(const std::string& key) const { return m_values.count(key) != 0; }
+    // key の値。無ければ fallback (数値として読めなければ WARNING を出して fallback。WARNING はキーごとに1回)
+    std::string get_string(const std::string& key, const std::string& fallback) const;
+    int get_int(const std::string& key, int fallback) const;
+    // min より小さい値は使えない (downscale = 0 など)。ERROR を出して fallback を返し、has_errors() を true にする
+    int get_int(const std::string& key, int fallback, int min) const;
+    float get_float(const std::string& key, float fallback) const;
+    bool get_bool(const std::string& key, bool fallback) const; // true/false, yes/no, on/off, 1/0
+
+    // 使えない値を読んだ (ERROR を出した) なら true。起動をやめる
+    bool has_errors() const { return m_has_errors; }
+
+    // 読み込んだが一度も get_*() されていないキー
+    std::vector<std::string> unused_keys() const;
+
+private:
+    const std::string* find(const std::string& key) const;
+    void warn(const std::string& key, const std::string& message) const;
+    void error(const std::string& key, const std::string& message) const;
+
+    std::map<std::string, std::string> m_values;
+    mutable std::set<std::string> m_used;
+    mutable std::set<std::string> m_warned; // 値が読めないと WARNING (か ERROR) を出したキー
+    mutable bool m_has_errors = false;
+    std::string m_path; // WARNING の表示用
+};
+
+// --- コマンドライン引数 ---
+
+// コマンドライン引数の prefix ("--detector=" など) の後ろの値。無ければ fallback (2回あれば先の方)
+std::string arg_value(int argc, char** argv, const std::string& prefix, const std::string& fallback);
+// 整数の値。整数として読めなければ WARNING を出して fallback
+int arg_value(int argc, char** argv, const std::string& prefix, int fallback);
+// 値を取らない引数 ("--gray" など) があれば true
+bool has_arg(int argc, char** argv, const std::string& flag);
+// "--" で始まる引数がすべて known にあるか確かめる ("=" で終わるものは値つき、それ以外はそのまま一致)
+// 知らない引数 (綴りの間違いなど) があれば ERROR を出して false
+bool check_args(int argc, char** argv, const std::vector<std::string>& known);
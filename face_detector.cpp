@@ -0,0 +1,202 @@
+#include "face_detector.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+
+FaceDetector::FaceDetector(const FaceDetectorParams& params)
+    : m_params(params), m_equalizer(params.equalizer), m_refine_equalizer(params.equalizer), m_tracker(params.tracker) {}
+
+bool FaceDetector::load() {
+    m_engine = make_face_engine(m_params);
+    return m_engine && m_engine->load();
+}
+
+std::string FaceDetector::engine_description() const {
+    if (!m_engine) return m_params.engine + " (unknown; available: " + face_engine_names() + ")";
+    return std::string(m_engine->name()) + " [" + m_engine->model_path() + "]";
+}
+
+FaceStatus FaceDetector::detect(const cv::Mat& frame, StageStats::Clock::time_point stamp, cv::Rect& face) {
+    FaceStatus status = find_face(frame, stamp, face);
+    if (m_stats) {
+        m_stats->record(Stage::Preprocess, m_preprocess_time);
+        m_stats->record(Stage::Detect, m_detect_time);
+    }
+    return status;
+}
+
+FaceStatus FaceDetector::find_face(const cv::Mat& frame, StageStats::Clock::time_point stamp, cv::Rect& face) {
+    m_preprocess_time = m_detect_time = StageStats::Clock::duration::zero();
+    auto start = StageStats::Clock::now();
+    const bool gray_frame = frame.type() == CV_8UC1; // カメラが Y (輝度) 面だけを出している
+    const bool fused = m_engine->input() == FaceEngine::Input::EqualizedGray && m_params.preprocess != "opencv";
+    if (fused) {
+        // 変換は detect_faces() で探索範囲だけ行う。出力の置き場はフレームサイズが変わったときだけ確保し直す
+        m_source = frame;
+        if (m_equalized.size() != frame.size()) m_equalized.create(frame.size(), CV_8UC1);
+    } else if (m_engine->input() == FaceEngine::Input::EqualizedGray) {
+        if (!gray_frame) {
+            cv::cvtColor(frame, m_gray, cv::COLOR_BGR2GRAY);
+            m_source = m_gray;
+        } else if (m_params.downscale > 1 && !m_params.refine_at_full_res) {
+            m_source = frame; // 変換もコピーも要らない (平坦化は縮小した画像に対して行う)
+        } else {
+            frame.copyTo(m_gray); // 元の解像度のまま平坦化するとフレームを書き換えてしまうのでコピーする
+            m_source = m_gray;
+        }
+    } else if (gray_frame) {
+        cv::cvtColor(frame, m_color, cv::COLOR_GRAY2BGR);
+        m_source = m_color;
+    } else {
+        m_source = frame; // カラーのまま使うエンジンは変換しない (コピーもしない)
+    }
+    m_preprocess_time += StageStats::Clock::now() - start;
+
+    // 縮小画像の置き場はフレームサイズ (と種類) が変わったときだけ確保し直す
+    // (距離で縮小を強めるときも、それより小さいのでこの置き場の一部を使う)
+    if ((m_params.downscale > 1 || m_params.range_gate) && !fused) {
+        int downscale = std::max(1, m_params.downscale);
+        cv::Size small_size(m_source.cols / downscale, m_source.rows / downscale);
+        if (m_small_buffer.size() != small_size || m_small_buffer.type() != m_source.type()) {
+            m_small_buffer.create(small_size, m_source.type());
+        }
+    }
+
+    // 探索範囲と顔サイズの範囲を決める (フレーム座標)
+    cv::Rect search_area(0, 0, m_source.cols, m_source.rows);
+    cv::Size min_size = m_params.min_size;
+    cv::Size max_size; // 空 = 上限なし
+    m_tracker.predict(stamp); // 今のフレームでの各顔の位置を予測する
+    const FaceTracker::Track* target = m_tracker.target();
+    if (target && ++m_frames_since_scan < m_params.full_scan_interval) {
+        // 目標の周囲だけを探す。見失っている間は探す範囲を広げていく
+        const cv::Rect& predicted = target->face;
+        cv::Rect roi = expand_rect(predicted, m_params.track_roi_margin * (1 + target->misses), m_source.size());
+        if (roi.width >= predicted.width && roi.height >= predicted.height) {
+            search_area = roi;
+            min_size = scale_size(predicted.size(), m_params.track_min_scale);
+            max_size = scale_size(predicted.size(), m_params.track_max_scale);
+        } else {
+            // 予測が画面の外に出た (ROIに顔が収まらない) ので、このフレームから全画面を探す
+            m_tracker.drop_target();
+        }
+    }
+    int downscale = std::max(1, m_params.downscale);
+    bool gated = false;
+    if (search_area.size() == m_source.size()) {
+        m_frames_since_scan = 0;
+        gated = gate_by_range(min_size, max_size, downscale);
+    }
+
+    m_frame_faces.clear();
+    detect_faces(search_area, downscale, min_size, max_size, m_equalizer, m_frame_faces);
+    if (gated) {
+        m_range_gated_scans.fetch_add(1, std::memory_order_relaxed);
+        m_gate_open_due = m_frame_faces.empty(); // 測っていたのは顔ではなかったかもしれない
+    }
+    // 縮小画像での検出は位置が粗いので、元の解像度で顔の周囲だけ探し直す (任意)
+    if (m_params.refine_at_full_res && m_params.downscale > 1) {
+        for (cv::Rect& found : m_frame_faces) {
+            m_refined.clear();
+            detect_faces(expand_rect(found, m_params.refine_margin, m_source.size()), 1,
+                         scale_size(found.size(), 0.8f), scale_size(found.size(), 1.25f), m_refine_equalizer, m_refined);
+            if (m_refined.empty()) continue;
+            found = *std::max_element(m_refined.begin(), m_refined.end(),
+                                      [](const cv::Rect& a, const cv::Rect& b) { return a.area() < b.area(); });
+        }
+    }
+
+    // 顔をトラックに割り当て、目標を選び直す
+    // 推定は検出した顔で補正するが、検出できたフレームで返すのは検出した顔そのもの
+    m_tracker.update(m_frame_faces, search_area, stamp);
+    target = m_tracker.target();
+    m_locked = target != nullptr;
+    m_target_id = target ? target->id : 0;
+    m_track_count = static_cast<int>(m_tracker.tracks().size());
+    if (!target) return FaceStatus::None;
+    face = target->face;
+    return target->misses == 0 ? FaceStatus::Detected : FaceStatus::Predicted; // 見失っている間は予測した位置で追う
+}
+
+// 全画面探索の顔サイズを、超音波の距離から予想した顔の幅の帯 (フレーム座標) に絞る。絞ったら true
+// 帯の下限が min_size の何倍もあるときは、その分 downscale も大きくする (探す画像が小さくなる)
+bool FaceDetector::gate_by_range(cv::Size& min_size, cv::Size& max_size, int& downscale) {
+    if (!m_params.range_gate || m_range_cm <= 0.0f || m_range_cm > m_params.range_gate_max_cm) return false;
+    if (m_gate_open_due) { // 前回絞って見つからなかったので、今回は全部のサイズを探す
+        m_gate_open_due = false;
+        return false;
+    }
+    float expected = m_tracker.expected_width_px(m_range_cm);
+    cv::Size gate_min = scale_size(cv::Size(cvRound(expected), cvRound(expected)), m_params.range_gate_min_scale);
+    cv::Size gate_max = scale_size(cv::Size(cvRound(expected), cvRound(expected)), m_params.range_gate_max_scale);
+    gate_min = cv::Size(std::max(gate_min.width, m_params.min_size.width), std::max(gate_min.height, m_params.min_size.height));
+    if (gate_max.width <= gate_min.width || gate_max.height <= gate_min.height) return false; // 予想した顔が小さすぎる
+    min_size = gate_min;
+    max_size = gate_max;
+    if (m_params.min_size.width > 0) {
+        downscale = std::min(std::max(downscale, min_size.width / m_params.min_size.width), m_params.range_gate_max_downscale);
+        downscale = std::max(downscale, std::max(1, m_params.downscale)); // 上限の設定が downscale より小さくても、元より細かくはしない
+    }
+    return true;
+}
+
+// m_source の search_area を downscale 分の1に縮小し (グレースケールのエンジンならヒストグラム平坦化もして)、
+// 顔を探して faces に足す。min_size/max_size と faces はフレーム座標
+// (downscale == 1 のときは m_gray の search_area をその場で平坦化する。カラーのフレームは書き換えない)
+// fused / cached の前処理では m_source (フレームそのもの) の search_area を1回読んで m_equalized に書く
+// (cached なら平坦化の LUT は equalizer が持ち回す)
+void FaceDetector::detect_faces(const cv::Rect& search_area, int downscale, const cv::Size& min_size,
+                                const cv::Size& max_size, HistogramEqualizer& equalizer, std::vector<cv::Rect>& faces) {
+    auto start = StageStats::Clock::now();
+    cv::Mat search_image = m_source(search_area);
+    float scale_x = 1.0f, scale_y = 1.0f; // 検出画像の1画素がフレームの何画素か
+    const bool equalize = m_engine->input() == FaceEngine::Input::EqualizedGray;
+    if (equalize && m_params.preprocess != "opencv") {
+        cv::Size small_size(search_area.width / downscale, search_area.height / downscale);
+        if (small_size.empty()) return;
+        search_image = m_equalized(cv::Rect(0, 0, small_size.width, small_size.height));
+        if (m_params.preprocess == "cached") {
+            equalizer.apply(m_source, search_area, downscale, search_image);
+        } else {
+            gray_equalize(m_source, search_area, downscale, search_image, m_lut);
+        }
+        scale_x = scale_y = static_cast<float>(downscale); // 割り切れない端は捨てるので倍率はちょうど downscale
+    } else if (downscale > 1) {
+        cv::Size small_size(search_area.width / downscale, search_area.height / downscale);
+        if (small_size.empty()) return;
+        // 確保済みの置き場の一部に直接縮小する (新しいバッファは作らない)
+        cv::Mat small = m_small_buffer(cv::Rect(0, 0, small_size.width, small_size.height));
+        cv::resize(search_image, small, small_size, 0, 0, cv::INTER_AREA);
+        scale_x = static_cast<float>(search_area.width) / small.cols;
+        scale_y = static_cast<float>(search_area.height) / small.rows;
+        search_image = small;
+    }
+    if (equalize && m_params.preprocess == "opencv") cv::equalizeHist(search_image, search_image);
+    auto preprocessed = StageStats::Clock::now();
+    m_preprocess_time += preprocessed - start;
+
+    m_faces.clear(); // 容量は残るので再確保されない
+    m_engine->detect(search_image, scale_size(min_size, 1.0f / scale_x), scale_size(max_size, 1.0f / scale_x), m_faces);
+    m_detect_time += StageStats::Clock::now() - preprocessed;
+
+    // 検出画像の座標 → フレーム座標
+    for (const cv::Rect& found : m_faces) {
+        faces.emplace_back(search_area.x + static_cast<int>(found.x * scale_x),
+                           search_area.y + static_cast<int>(found.y * scale_y),
+                           static_cast<int>(found.width * scale_x),
+                           static_cast<int>(found.height * scale_y));
+    }
+}
+
+cv::Rect expand_rect(const cv::Rect& rect, float margin, const cv::Size& bounds) {
+    int dx = static_cast<int>(rect.width * margin);
+    int dy = static_cast<int>(rect.height * margin);
+    cv::Rect expanded(rect.x - dx, rect.y - dy, rect.width + 2 * dx, rect.height + 2 * dy);
+    return expanded & cv::Rect(0, 0, bounds.width, bounds.height);
+}
+
+cv::Size scale_size(const cv::Size& size, float scale) {
+    return cv::Size(static_cast<int>(size.width * scale), static_cast<int>(size.height * scale));
+}
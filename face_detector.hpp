@@ -0,0 +1,152 @@
+#pragma once
+// 顔検出と追跡 (Aさん担当箇所)
+//
+// 見つけた顔はすべて FaceTracker (face_tracker.hpp) で ID を付けて追い、そのうち1つを目標として選ぶ。
+// 目標があると、次からはカルマンフィルタで予測した目標の周囲 (ROI) だけを予測に近いサイズで探す
+// (他の人は full_scan_interval フレームごとの全画面探索で追い直す)。見失ったフレームでは予測した位置を返し
+// (FaceStatus::Predicted)、ROI を広げながら探し続ける。tracker.max_misses 回続けて見失ったら、
+// 他に追っている顔があればそちらに移り、無ければ全画面探索に戻る。
+// 検出は downscale 分の1に縮小した画像で行い、結果は元のフレーム座標に戻して返す。
+// 全画面を探すときは、超音波の距離 (set_range_cm) から予想した顔の幅の前後 (range_gate_min/max_scale) だけを探す。
+// 予想した顔が大きければ縮小も強める (帯の下限が min_size になるまで) ので、DNN のエンジンも入力が小さくなる。
+// 超音波は顔ではなく手前の物を測っていることもあるので、絞って見つからなかった次の全画面探索は全部のサイズを探す。
+// 検出器の本体 (Haar / LBP / YuNet / SSD) は FaceEngine (face_engine.hpp) で、engine で選ぶ。
+// グレースケールのエンジンの前処理は、既定では gray_preprocess.hpp のカーネルで探索範囲だけを1回で
+// グレースケール化・縮小・平坦化する (preprocess = "opencv" で従来の cvtColor → resize → equalizeHist)。
+// 作業用の画像とベクタはオブジェクトが持ち回すので、フレームサイズが変わらない限り
+// 毎フレームのヒープ確保は起きない。1つのスレッドからだけ使うこと。
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "face_engine.hpp"
+#include "face_tracker.hpp"
+#include "gray_preprocess.hpp"
+#include "stage_stats.hpp"
+
+// 顔検出・追跡パラメータ (要調整)
+struct FaceDetectorParams {
+    std::string engine = "haar";     // 検出エンジン (haar, lbp, yunet, ssd。face_engine.hpp を参照)
+    std::string cascade_path = "/usr/share/opencv4/haarcascades/haarcascade_frontalface_alt.xml"; // 明日、正確なパスを確認！
+    std::string lbp_cascade_path = "/usr/share/opencv4/lbpcascades/lbpcascade_frontalface_improved.xml";
+    std::string yunet_model_path = "models/face_detection_yunet_2023mar.onnx";
+    std::string ssd_model_path = "models/opencv_face_detector_uint8.pb";
+    std::string ssd_config_path = "models/opencv_face_detector.pbtxt";
+    float dnn_score_threshold = 0.6f; // yunet / ssd でこのスコア未満の顔は捨てる
+    std::string preprocess = "fused"; // グレースケールのエンジンの前処理 (fused, cached, opencv。gray_preprocess.hpp を参照)
+    int detect_threads = 1;          // haar / lbp で並列に探すスレッド数 (キャプチャ・測距などのスレッドの分のコアは残す)
+    cv::Size min_size{30, 30};       // 全画面探索での最小の顔サイズ
+    float track_roi_margin = 0.5f;   // 追跡中の探索範囲: 前回の顔の周囲に顔サイズ×この割合だけ広げる
+    float track_min_scale = 0.7f;    // 追跡中に探す顔サイズの下限 (前回の顔サイズに対する倍率)
+    float track_max_scale = 1.4f;    // 追跡中に探す顔サイズの上限
+    int full_scan_interval = 15;     // 追跡中もこのフレーム数ごとに全画面を探す (他の人を見つけ・追い直すため)
+    int downscale = 2;               // 検出用に縮小する倍率 (1: 640x480のまま, 2: 320x240, 4: 160x120)
+    bool refine_at_full_res = false; // 縮小画像で見つけた顔を、元の解像度で周囲だけ探し直して位置を補正する
+    float refine_margin = 0.25f;     // 補正時の探索範囲: 顔の周囲に顔サイズ×この割合だけ広げる
+    bool range_gate = true;          // 全画面探索で、超音波の距離から予想した顔サイズの帯だけを探す
+    float range_gate_min_scale = 0.6f; // 探す顔の幅の下限 (予想した幅に対する倍率。顔の大きさの個人差・向きの分)
+    float range_gate_max_scale = 1.6f; // 探す顔の幅の上限
+    float range_gate_max_cm = 250.0f;  // これより遠いときは絞らない (超音波の広がりが大きく、顔以外を測りやすい)
+    int range_gate_max_downscale = 6;  // 予想した顔が大きいときに縮小を強める上限の倍率
+    FaceTrackerParams tracker;       // 複数の顔の追跡と目標の選び方
+    EqualizerParams equalizer;       // cached: 平坦化の LUT を作り直す間隔
+};
+
+// detect() の結果
+enum class FaceStatus {
+    None,      // 顔が無い
+    Detected,  // このフレームで検出した
+    Predicted, // 見失ったが、追跡中なので予測した位置を返した
+};
+
+class FaceDetector {
+public:
+    explicit FaceDetector(const FaceDetectorParams& params = FaceDetectorParams());
+
+    // 検出エンジンを作ってモデルを読み込む。失敗したら false
+    bool load();
+    // load() の前に検出エンジンを選び直す
+    void set_engine(const std::string& engine) { m_params.engine = engine; }
+    void set_detect_threads(int threads) { m_params.detect_threads = threads; }
+    void set_preprocess(const std::string& mode) { m_params.preprocess = mode; }
+    // 目標の選び方 (sticky, largest, closest)。load() の前に呼ぶ
+    void set_target_policy(const std::string& policy) {
+        m_params.tracker.policy = policy;
+        m_tracker = FaceTracker(m_params.tracker);
+    }
+    // 超音波の距離 (cm, 測れていなければ 0 以下)。closest の目標選びと全画面探索の顔サイズに使う
+    // detect() と同じスレッドから呼ぶ
+    void set_range_cm(float range_cm) {
+        m_range_cm = range_cm;
+        m_tracker.set_range_cm(range_cm);
+    }
+    // エラー表示用 (例: "haar [/usr/share/..../haarcascade_frontalface_alt.xml]")
+    std::string engine_description() const;
+
+    // フレーム (BGR か、カメラから来たグレースケール) から顔を探し、目標の顔を face (フレーム座標) に入れる
+    // stamp はそのフレームを撮った時刻 (追跡中の予測に使う)。None のときは face を変えない
+    FaceStatus detect(const cv::Mat& frame, StageStats::Clock::time_point stamp, cv::Rect& face);
+
+    // 前処理と検出の所要時間を stats に記録する (nullptr で記録しない)
+    void set_stats(StageStats* stats) { m_stats = stats; }
+
+    // 追跡中 (ROIだけを探している) なら true。他のスレッドから呼んでもよい
+    bool tracking() const { return m_locked; }
+    // 目標の顔の ID (0 = なし) と追っている顔の数。他のスレッドから呼んでもよい
+    int target_id() const { return m_target_id; }
+    int track_count() const { return m_track_count; }
+    // 距離で顔サイズを絞った全画面探索の回数。他のスレッドから呼んでもよい
+    uint64_t range_gated_scans() const { return m_range_gated_scans; }
+    // cached: 平坦化の LUT を作り直した回数 (detect() と同じスレッドから呼ぶ)
+    uint64_t lut_refreshes() const { return m_equalizer.refreshes() + m_refine_equalizer.refreshes(); }
+
+    const FaceDetectorParams& params() const { return m_params; }
+
+private:
+    FaceStatus find_face(const cv::Mat& frame, StageStats::Clock::time_point stamp, cv::Rect& face);
+    bool gate_by_range(cv::Size& min_size, cv::Size& max_size, int& downscale);
+    void detect_faces(const cv::Rect& search_area, int downscale, const cv::Size& min_size, const cv::Size& max_size,
+                      HistogramEqualizer& equalizer, std::vector<cv::Rect>& faces);
+
+    FaceDetectorParams m_params;
+    std::unique_ptr<FaceEngine> m_engine;
+    StageStats* m_stats = nullptr;
+
+    // 1回の detect() 中の前処理・検出時間の合計 (補正で2回探すことがあるので足し込む)
+    StageStats::Clock::duration m_preprocess_time{};
+    StageStats::Clock::duration m_detect_time{};
+
+    // 作業領域 (使い回す)
+    cv::Mat m_gray;              // フレーム全体のグレースケール (グレースケールを使うエンジンのとき)
+    cv::Mat m_color;             // グレースケールのフレームをカラーのエンジンに渡すときの変換先
+    cv::Mat m_source;            // エンジンに渡す元の画像 (m_gray, m_color, またはフレームそのもの)
+    cv::Mat m_small_buffer;      // 縮小画像の置き場 (全画面を縮小したサイズで確保し、ROIはその一部を使う)
+    cv::Mat m_equalized;         // fused の前処理の出力の置き場 (フレームと同じ大きさで確保し、その一部を使う)
+    cv::Mat m_lut;               // fused の平坦化の LUT
+    HistogramEqualizer m_equalizer;        // cached: 探索範囲の LUT
+    HistogramEqualizer m_refine_equalizer; // cached: 元の解像度で探し直すときの LUT (顔の周囲なので分布が違う)
+    std::vector<cv::Rect> m_faces;       // エンジンの結果 (検出画像の座標)
+    std::vector<cv::Rect> m_frame_faces; // このフレームで見つけた顔 (フレーム座標)
+    std::vector<cv::Rect> m_refined;
+
+    // 追跡の状態
+    FaceTracker m_tracker;
+    int m_frames_since_scan = 0;        // 前回全画面を探してからのフレーム数
+    std::atomic<bool> m_locked{false};  // true の間は目標の周囲だけを探す (tracking() は他スレッドから読んでよい)
+    std::atomic<int> m_target_id{0};
+    std::atomic<int> m_track_count{0};
+
+    // 距離による顔サイズの絞り込み
+    float m_range_cm = 0.0f;
+    bool m_gate_open_due = false; // 前回絞って見つからなかった (次の全画面探索は絞らない)
+    std::atomic<uint64_t> m_range_gated_scans{0};
+};
+
+// rect を各辺に rect のサイズ×margin だけ広げ、bounds の範囲に収める
+cv::Rect expand_rect(const cv::Rect& rect, float margin, const cv::Size& bounds);
+// size の幅と高さを scale 倍する
+cv::Size scale_size(const cv::Size& size, float scale);
@@ -0,0 +1,247 @@
+#include "face_engine.hpp"
+
+#include <algorithm>
+
+#include <opencv2/opencv_modules.hpp>
+#include <opencv2/objdetect.hpp>
+#ifdef HAVE_OPENCV_DNN
+#include <opencv2/dnn.hpp>
+#endif
+
+#include "face_detector.hpp"
+#include "worker_pool.hpp"
+
+// cv::FaceDetectorYN は OpenCV 4.6 から (dnn モジュールが必要)
+#if defined(HAVE_OPENCV_DNN) && (CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6))
+#define RAS_EYE_HAVE_YUNET 1
+#endif
+
+namespace {
+
+bool size_in_range(const cv::Rect& face, const cv::Size& min_size, const cv::Size& max_size) {
+    if (face.width < min_size.width || face.height < min_size.height) return false;
+    if (!max_size.empty() && (face.width > max_size.width || face.height > max_size.height)) return false;
+    return true;
+}
+
+// Haar / LBP カスケード (読み込むファイルが違うだけ)
+// threads が 2 以上なら、画像ピラミッドの段 (顔サイズ) を threads 個の帯に分けて並列に探す。
+// 各帯は近傍数 0 (まとめる前の候補のまま) で探し、全部の帯の候補をまとめてから
+// detectMultiScale と同じ groupRectangles をかけるので、結果は1スレッドで探したときと同じになる。
+// CascadeClassifier はスレッド間で共有できないので、スレッドごとに読み込んでおく。
+class CascadeEngine : public FaceEngine {
+public:
+    CascadeEngine(const char* name, const std::string& path, int threads)
+        : m_name(name), m_path(path), m_cascades(std::max(1, threads)), m_pool(std::max(1, threads)) {}
+
+    const char* name() const override { return m_name; }
+    std::string model_path() const override { return m_path; }
+    Input input() const override { return Input::EqualizedGray; }
+
+    bool load() override {
+        for (cv::CascadeClassifier& cascade : m_cascades) {
+            if (!cascade.load(m_path)) return false;
+        }
+        return true;
+    }
+
+    void detect(const cv::Mat& image, const cv::Size& min_size, const cv::Size& max_size,
+                std::vector<cv::Rect>& faces) override {
+        if (m_cascades.size() == 1) {
+            m_cascades[0].detectMultiScale(image, faces, SCALE_FACTOR, MIN_NEIGHBORS, 0 | cv::CASCADE_SCALE_IMAGE,
+                                           min_size, max_size);
+            return;
+        }
+
+        split_scales(image.size(), min_size, max_size);
+        m_band_faces.resize(m_bands.size());
+        m_pool.run(m_bands.size(), [&](size_t i) {
+            m_band_faces[i].clear();
+            m_cascades[i].detectMultiScale(image, m_band_faces[i], SCALE_FACTOR, 0, 0 | cv::CASCADE_SCALE_IMAGE,
+                                           m_bands[i].min_size, m_bands[i].max_size);
+        });
+        for (const std::vector<cv::Rect>& band : m_band_faces) faces.insert(faces.end(), band.begin(), band.end());
+        cv::groupRectangles(faces, MIN_NEIGHBORS, GROUP_EPS);
+    }
+
+private:
+    static constexpr double SCALE_FACTOR = 1.1;
+    static const int MIN_NEIGHBORS = 2;
+    static constexpr double GROUP_EPS = 0.2; // detectMultiScale の中でまとめるときと同じ値
+
+    struct Band {
+        cv::Size min_size; // この帯で探す窓の大きさ (両端を含む)
+        cv::Size max_size;
+    };
+
+    // detectMultiScale と同じ順に段を数え上げ、処理量 (縮小した画像の画素数) がほぼ等しくなるように帯に分ける
+    // 小さい顔の段ほど画像が大きくて重いので、一番細かい段は1段だけで1つの帯になることが多い
+    void split_scales(const cv::Size& image_size, const cv::Size& min_size, const cv::Size& max_size) {
+        const cv::Size window = m_cascades[0].getOriginalWindowSize();
+        const cv::Size max_window = max_size.empty() ? image_size : max_size;
+        m_levels.clear();
+        double total = 0.0;
+        for (double factor = 1.0;; factor *= SCALE_FACTOR) {
+            cv::Size scaled(cvRound(image_size.width / factor), cvRound(image_size.height / factor));
+            if (scaled.width < window.width || scaled.height < window.height) break;
+            cv::Size size(cvRound(window.width * factor), cvRound(window.height * factor));
+            if (size.width > max_window.width || size.height > max_window.height) break;
+            if (size.width < min_size.width || size.height < min_size.height) continue;
+            double cost = static_cast<double>(scaled.area());
+            m_levels.push_back({size, cost});
+            total += cost;
+        }
+
+        m_bands.clear();
+        const size_t band_count = std::min(m_cascades.size(), m_levels.size());
+        double accumulated = 0.0;
+        for (size_t i = 0; i < m_levels.size(); ++i) {
+            if (m_bands.empty() || (accumulated >= total * m_bands.size() / band_count
+                                    && m_levels.size() - i >= band_count - m_bands.size())) {
+                if (m_bands.size() < band_count) m_bands.push_back({m_levels[i].size, m_levels[i].size});
+            }
+            m_bands.back().max_size = m_levels[i].size;
+            accumulated += m_levels[i].cost;
+        }
+    }
+
+    struct Level {
+        cv::Size size; // 窓の大きさ
+        double cost;
+    };
+
+    const char* m_name;
+    std::string m_path;
+    std::vector<cv::CascadeClassifier> m_cascades; // スレッドごと
+    WorkerPool m_pool;
+
+    // 作業領域 (使い回す)
+    std::vector<Level> m_levels;
+    std::vector<Band> m_bands;
+    std::vector<std::vector<cv::Rect>> m_band_faces;
+};
+
+#ifdef RAS_EYE_HAVE_YUNET
+// YuNet (cv::FaceDetectorYN)。入力サイズは変わったときだけ設定し直す
+class YuNetEngine : public FaceEngine {
+public:
+    explicit YuNetEngine(const FaceDetectorParams& params) : m_params(params) {}
+
+    const char* name() const override { return "yunet"; }
+    std::string model_path() const override { return m_params.yunet_model_path; }
+    Input input() const override { return Input::Bgr; }
+
+    bool load() override {
+        try {
+            m_yunet = cv::FaceDetectorYN::create(m_params.yunet_model_path, "", cv::Size(320, 240),
+                                                 m_params.dnn_score_threshold, 0.3f, 50,
+                                                 cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_CPU);
+        } catch (const cv::Exception&) {
+            return false;
+        }
+        return !m_yunet.empty();
+    }
+
+    void detect(const cv::Mat& image, const cv::Size& min_size, const cv::Size& max_size,
+                std::vector<cv::Rect>& faces) override {
+        if (image.size() != m_input_size) {
+            m_input_size = image.size();
+            m_yunet->setInputSize(m_input_size);
+        }
+        m_yunet->detect(image, m_output);
+        // 1行が1つの顔: x, y, w, h, 目・鼻・口の5点 (10個), スコア
+        for (int i = 0; i < m_output.rows; ++i) {
+            const float* row = m_output.ptr<float>(i);
+            cv::Rect face(static_cast<int>(row[0]), static_cast<int>(row[1]),
+                          static_cast<int>(row[2]), static_cast<int>(row[3]));
+            face &= cv::Rect(0, 0, image.cols, image.rows);
+            if (size_in_range(face, min_size, max_size)) faces.push_back(face);
+        }
+    }
+
+private:
+    FaceDetectorParams m_params;
+    cv::Ptr<cv::FaceDetectorYN> m_yunet;
+    cv::Size m_input_size;
+    cv::Mat m_output;
+};
+#endif
+
+#ifdef HAVE_OPENCV_DNN
+// SSD (ResNet-10, 300x300 入力)。8bit 量子化した TensorFlow 版か Caffe 版を読む
+class SsdEngine : public FaceEngine {
+public:
+    explicit SsdEngine(const FaceDetectorParams& params) : m_params(params) {}
+
+    const char* name() const override { return "ssd"; }
+    std::string model_path() const override { return m_params.ssd_model_path; }
+    Input input() const override { return Input::Bgr; }
+
+    bool load() override {
+        try {
+            m_net = cv::dnn::readNet(m_params.ssd_model_path, m_params.ssd_config_path);
+        } catch (const cv::Exception&) {
+            return false;
+        }
+        if (m_net.empty()) return false;
+        m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        return true;
+    }
+
+    void detect(const cv::Mat& image, const cv::Size& min_size, const cv::Size& max_size,
+                std::vector<cv::Rect>& faces) override {
+        // 入力の置き場 (m_blob) は使い回す
+        cv::dnn::blobFromImage(image, m_blob, 1.0, cv::Size(300, 300), cv::Scalar(104, 177, 123), false, false);
+        m_net.setInput(m_blob);
+        m_output = m_net.forward();
+
+        // 出力は [1, 1, N, 7]: (画像番号, クラス, スコア, 左, 上, 右, 下) で座標は 0〜1
+        const int count = static_cast<int>(m_output.total() / 7);
+        const float* data = m_output.ptr<float>();
+        for (int i = 0; i < count; ++i) {
+            const float* det = data + i * 7;
+            if (det[2] < m_params.dnn_score_threshold) continue;
+            cv::Rect face(cv::Point(static_cast<int>(det[3] * image.cols), static_cast<int>(det[4] * image.rows)),
+                          cv::Point(static_cast<int>(det[5] * image.cols), static_cast<int>(det[6] * image.rows)));
+            face &= cv::Rect(0, 0, image.cols, image.rows);
+            if (size_in_range(face, min_size, max_size)) faces.push_back(face);
+        }
+    }
+
+private:
+    FaceDetectorParams m_params;
+    cv::dnn::Net m_net;
+    cv::Mat m_blob;
+    cv::Mat m_output;
+};
+#endif
+
+}
+
+std::unique_ptr<FaceEngine> make_face_engine(const FaceDetectorParams& params) {
+    if (params.engine == "haar") {
+        return std::unique_ptr<FaceEngine>(new CascadeEngine("haar", params.cascade_path, params.detect_threads));
+    }
+    if (params.engine == "lbp") {
+        return std::unique_ptr<FaceEngine>(new CascadeEngine("lbp", params.lbp_cascade_path, params.detect_threads));
+    }
+#ifdef RAS_EYE_HAVE_YUNET
+    if (params.engine == "yunet") return std::unique_ptr<FaceEngine>(new YuNetEngine(params));
+#endif
+#ifdef HAVE_OPENCV_DNN
+    if (params.engine == "ssd") return std::unique_ptr<FaceEngine>(new SsdEngine(params));
+#endif
+    return nullptr;
+}
+
+std::string face_engine_names() {
+    std::string names = "haar, lbp";
+#ifdef RAS_EYE_HAVE_YUNET
+    names += ", yunet";
+#endif
+#ifdef HAVE_OPENCV_DNN
+    names += ", ssd";
+#endif
+    return names;
+}
@@ -0,0 +1,48 @@
+#pragma once
+// 顔検出エンジン (FaceDetector から使う検出器の本体)
+//
+// FaceDetector が探索範囲の切り出し・縮小・追跡を受け持ち、エンジンは渡された画像から顔を探すだけ。
+// 速さと精度のバランスは Raspberry Pi の機種で変わるので、FaceDetectorParams::engine で選ぶ:
+//   "haar"  : Haar カスケード (従来どおり。遅いが追加のファイルが要らない)
+//   "lbp"   : LBP カスケード (Haar より数倍速い。横顔・暗い場所には弱い)
+//   "yunet" : cv::FaceDetectorYN (YuNet, ONNX。OpenCV 4.6 以降。精度が高く、縮小画像でもそれなりに見つかる)
+//   "ssd"   : OpenCV DNN の SSD (opencv_face_detector_uint8.pb, 8bit 量子化版)
+// DNN の2つは OpenCV 自身の CPU バックエンドで動かす (ARM では NEON のカーネルが使われる)。
+// カスケードの2つは FaceDetectorParams::detect_threads 本のスレッドで顔サイズを分けて並列に探せる
+// (DNN の2つのスレッド数は OpenCV 側 (cv::setNumThreads) に任せる)。
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct FaceDetectorParams;
+
+class FaceEngine {
+public:
+    // エンジンに渡す画像の種類
+    enum class Input {
+        EqualizedGray, // ヒストグラム平坦化したグレースケール (CV_8UC1)
+        Bgr,           // カラーのまま (CV_8UC3)
+    };
+
+    virtual ~FaceEngine() = default;
+
+    virtual const char* name() const = 0;
+    // 読み込むモデルのファイル (エラー表示用)
+    virtual std::string model_path() const = 0;
+    virtual Input input() const = 0;
+
+    // モデルを読み込む。失敗したら false
+    virtual bool load() = 0;
+    // image の中の顔を faces (image の座標) に入れる。faces は呼ぶ側で空にしておくこと
+    // min_size/max_size は image の座標での顔サイズの範囲 (max_size が空なら上限なし)
+    virtual void detect(const cv::Mat& image, const cv::Size& min_size, const cv::Size& max_size,
+                        std::vector<cv::Rect>& faces) = 0;
+};
+
+// params.engine のエンジンを作る。知らない名前か、この OpenCV で使えなければ nullptr
+std::unique_ptr<FaceEngine> make_face_engine(const FaceDetectorParams& params);
+// 使えるエンジンの名前 (表示用, 例: "haar, lbp, yunet, ssd")
+std::string face_engine_names();
@@ -0,0 +1,239 @@
+#include "face_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+const double NO_MATCH = 1e6; // 同じ人とはみなさない組み合わせのコスト
+
+cv::Point2f rect_center(const cv::Rect& rect) {
+    return cv::Point2f(rect.x + rect.width * 0.5f, rect.y + rect.height * 0.5f);
+}
+
+}
+
+FaceTracker::FaceTracker(const FaceTrackerParams& params) : m_params(params) {
+    m_tracks.reserve(m_params.max_tracks); // Track は移動だけで済ませる (再確保でコピーさせない)
+}
+
+void FaceTracker::predict(Clock::time_point stamp) {
+    for (Track& track : m_tracks) track.face = track.filter.predict(stamp);
+}
+
+void FaceTracker::update(const std::vector<cv::Rect>& faces, const cv::Rect& search_area, Clock::time_point stamp) {
+    associate(faces);
+
+    for (size_t i = 0; i < m_tracks.size(); ++i) {
+        Track& track = m_tracks[i];
+        if (m_track_face[i] >= 0) {
+            track.face = faces[m_track_face[i]];
+            track.filter.correct(track.face);
+            track.misses = 0;
+            track.last_seen = stamp;
+        } else if (search_area.contains(rect_center(track.face))) {
+            ++track.misses; // 探したのに見つからなかった (探していない場所にいるトラックは数えない)
+        } else if (track.misses == 0) {
+            track.misses = 1; // 検出はしていないので予測扱いにする
+        }
+    }
+
+    // 見失ったトラックを消す
+    size_t kept = 0;
+    for (size_t i = 0; i < m_tracks.size(); ++i) {
+        const Track& track = m_tracks[i];
+        if (track.misses >= m_params.max_misses || stamp - track.last_seen > m_params.max_unseen) continue;
+        if (kept != i) m_tracks[kept] = std::move(m_tracks[i]);
+        ++kept;
+    }
+    m_tracks.resize(kept);
+
+    // 割り当たらなかった顔は新しい人
+    for (size_t j = 0; j < faces.size() && m_tracks.size() < m_params.max_tracks; ++j) {
+        if (m_face_used[j]) continue;
+        Track track;
+        track.id = m_next_id++;
+        track.filter = TargetFilter(m_params.filter);
+        track.filter.reset(faces[j], stamp);
+        track.face = faces[j];
+        track.last_seen = stamp;
+        m_tracks.push_back(std::move(track));
+    }
+
+    select_target();
+}
+
+void FaceTracker::clear() {
+    m_tracks.clear();
+    m_target_id = 0;
+}
+
+const FaceTracker::Track* FaceTracker::target() const {
+    for (const Track& track : m_tracks) {
+        if (track.id == m_target_id) return &track;
+    }
+    return nullptr;
+}
+
+void FaceTracker::drop_target() {
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(),
+                                  [this](const Track& track) { return track.id == m_target_id; }),
+                   m_tracks.end());
+    m_target_id = 0;
+}
+
+// 予測した枠と検出した枠の組み合わせごとにコストを付け、合計が最小になるように割り当てる
+void FaceTracker::associate(const std::vector<cv::Rect>& faces) {
+    const int rows = static_cast<int>(m_tracks.size());
+    const int cols = static_cast<int>(faces.size());
+    m_face_used.assign(faces.size(), false);
+    m_track_face.assign(m_tracks.size(), -1);
+    if (rows == 0 || cols == 0) return;
+
+    m_cost.resize(static_cast<size_t>(rows) * cols);
+    for (int i = 0; i < rows; ++i) {
+        const cv::Rect& predicted = m_tracks[i].face;
+        cv::Point2f center = rect_center(predicted);
+        for (int j = 0; j < cols; ++j) {
+            double cost = NO_MATCH;
+            float iou = rect_iou(predicted, faces[j]);
+            cv::Point2f shift = rect_center(faces[j]) - center;
+            float shift_ratio = std::hypot(shift.x, shift.y) / std::max(1, predicted.width);
+            if (iou >= m_params.min_iou) {
+                cost = 1.0 - iou;
+            } else if (shift_ratio <= m_params.max_center_shift) {
+                cost = 1.0 + shift_ratio; // 重なりが少なくても近ければ候補にする (重なる組み合わせより後回し)
+            }
+            m_cost[static_cast<size_t>(i) * cols + j] = cost;
+        }
+    }
+
+    solve_assignment(m_cost, rows, cols, m_track_face);
+    for (int i = 0; i < rows; ++i) {
+        int j = m_track_face[i];
+        if (j < 0) continue;
+        if (m_cost[static_cast<size_t>(i) * cols + j] >= NO_MATCH) {
+            m_track_face[i] = -1; // 近い顔が無かった
+        } else {
+            m_face_used[j] = true;
+        }
+    }
+}
+
+void FaceTracker::select_target() {
+    const Track* current = target();
+    if (m_params.policy == "sticky" && current) return;
+
+    // 一番大きい顔
+    const Track* largest = nullptr;
+    for (const Track& track : m_tracks) {
+        if (!largest || track.face.width > largest->face.width) largest = &track;
+    }
+    const Track* best = largest;
+    if (current && largest && largest->face.width < current->face.width * m_params.switch_ratio) best = current;
+
+    // 超音波の距離に一番合う顔 (乗り換えは誤差が switch_ratio 分の1以下になったときだけ)
+    if (m_params.policy == "closest" && m_range_cm > 0.0f) {
+        const Track* closest = nullptr;
+        float closest_error = 0.0f;
+        for (const Track& track : m_tracks) {
+            float error = std::abs(estimated_distance_cm(track.face) - m_range_cm);
+            if (!closest || error < closest_error) {
+                closest = &track;
+                closest_error = error;
+            }
+        }
+        best = closest;
+        if (current && closest) {
+            float current_error = std::abs(estimated_distance_cm(current->face) - m_range_cm);
+            if (closest_error * m_params.switch_ratio > current_error) best = current;
+        }
+    }
+
+    m_target_id = best ? best->id : 0;
+}
+
+float FaceTracker::expected_width_px(float distance_cm) const {
+    return m_params.focal_length_px * m_params.face_width_cm / std::max(1.0f, distance_cm);
+}
+
+float FaceTracker::estimated_distance_cm(const cv::Rect& face) const {
+    return m_params.focal_length_px * m_params.face_width_cm / std::max(1, face.width);
+}
+
+void solve_assignment(const std::vector<double>& cost, int rows, int cols, std::vector<int>& assignment) {
+    assignment.assign(rows, -1);
+    if (rows == 0 || cols == 0) return;
+
+    // 行 (n) が列 (m) 以下になるように、必要なら転置して解く
+    const bool transposed = rows > cols;
+    const int n = transposed ? cols : rows;
+    const int m = transposed ? rows : cols;
+    auto at = [&](int i, int j) {
+        return transposed ? cost[static_cast<size_t>(j) * cols + i] : cost[static_cast<size_t>(i) * cols + j];
+    };
+
+    // ポテンシャル u, v を使う O(n^2 m) の実装 (添字は 1 から, p[j] は列 j に割り当てた行)
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> u(n + 1, 0.0), v(m + 1, 0.0), minv(m + 1);
+    std::vector<int> p(m + 1, 0), way(m + 1, 0);
+    std::vector<bool> used(m + 1);
+    for (int i = 1; i <= n; ++i) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv.begin(), minv.end(), INF);
+        std::fill(used.begin(), used.end(), false);
+        do {
+            used[j0] = true;
+            int i0 = p[j0], j1 = 0;
+            double delta = INF;
+            for (int j = 1; j <= m; ++j) {
+                if (used[j]) continue;
+                double reduced = at(i0 - 1, j - 1) - u[i0] - v[j];
+                if (reduced < minv[j]) {
+                    minv[j] = reduced;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do { // 増加路に沿って割り当てを入れ替える
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    for (int j = 1; j <= m; ++j) {
+        if (p[j] == 0) continue;
+        if (transposed) {
+            assignment[j - 1] = p[j] - 1;
+        } else {
+            assignment[p[j] - 1] = j - 1;
+        }
+    }
+}
+
+float rect_iou(const cv::Rect& a, const cv::Rect& b) {
+    int overlap = (a & b).area();
+    int combined = a.area() + b.area() - overlap;
+    return combined > 0 ? static_cast<float>(overlap) / combined : 0.0f;
+}
+
+bool is_target_policy(const std::string& policy) {
+    return policy == "sticky" || policy == "largest" || policy == "closest";
+}
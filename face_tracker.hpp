@@ -0,0 +1,96 @@
+#pragma once
+// 複数の顔の追跡と、追う顔 (目標) の選択
+//
+// 検出した顔を、顔ごとのトラック (ID とカルマンフィルタ TargetFilter を持つ) に割り当てる。
+// 割り当ては予測した枠との重なり (IoU) をコストにしたハンガリアン法で、全体として最も良い組み合わせにする。
+// 割り当たらなかった顔は新しい ID のトラックになる。探した範囲にいたのに見つからなかったトラックは
+// 予測で追い続け、max_misses 回続けて見つからなければ消す。
+// 追う顔は policy で選ぶ:
+//   "sticky"  : 今の目標を見失うまで追い続ける (見失ったら一番大きい顔)
+//   "largest" : 一番大きい顔 (今の目標より switch_ratio 倍以上大きくなったときだけ乗り換える)
+//   "closest" : 超音波で測った距離に、顔の幅から推定した距離が一番近い顔 (距離が無ければ largest と同じ)
+// 2人が映っていても目標が毎フレーム入れ替わらないので、サーボが2人の間を行き来しない。
+// 1つのスレッドからだけ使うこと。
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "target_filter.hpp"
+
+// 追跡パラメータ (要調整)
+struct FaceTrackerParams {
+    std::string policy = "sticky";      // 目標の選び方 (sticky, largest, closest)
+    float min_iou = 0.2f;               // 予測した枠とこの割合以上重なる顔を同じ人とみなす
+    float max_center_shift = 0.5f;      // 重ならなくても、中心のずれが予測した顔の幅×この割合以内なら同じ人とみなす
+    int max_misses = 5;                 // 探したのにこの回数続けて見つからなければトラックを消す
+    std::chrono::milliseconds max_unseen{2000}; // 探していなくても、この時間見つかっていないトラックは消す
+    size_t max_tracks = 8;              // 同時に追う顔の数の上限
+    float switch_ratio = 1.3f;          // largest: 今の目標よりこの倍率以上大きい顔に乗り換える (面積ではなく幅)
+    float focal_length_px = 500.0f;     // closest: 顔の幅から距離を求めるための焦点距離 (640x480 の画素単位)
+    float face_width_cm = 15.0f;        // closest: 顔の幅の実寸
+    TargetFilterParams filter;          // 顔ごとの位置・サイズの予測
+};
+
+class FaceTracker {
+public:
+    using Clock = TargetFilter::Clock;
+
+    struct Track {
+        int id = 0;
+        TargetFilter filter;
+        cv::Rect face;          // 最後に検出した枠か、見失っている間は予測した枠 (フレーム座標)
+        int misses = 0;         // 探したのに続けて見つからなかった回数 (0 = このフレームで検出した)
+        Clock::time_point last_seen;
+    };
+
+    explicit FaceTracker(const FaceTrackerParams& params = FaceTrackerParams());
+
+    // stamp の時点の各トラックの位置を予測する (update() の前に1回呼ぶ)
+    void predict(Clock::time_point stamp);
+    // search_area (フレーム座標) で見つけた faces をトラックに割り当て、目標を選び直す
+    // 予測した中心が search_area の外にあるトラックは、見つからなくても見逃しとして数えない
+    void update(const std::vector<cv::Rect>& faces, const cv::Rect& search_area, Clock::time_point stamp);
+    // 全部のトラックを消す
+    void clear();
+
+    // 追っている顔。無ければ nullptr
+    const Track* target() const;
+    // 目標を消す (予測が画面の外に出たときなど)。次の update() で選び直す
+    void drop_target();
+    const std::vector<Track>& tracks() const { return m_tracks; }
+
+    // closest 用の超音波の距離 (cm)。測れていなければ 0 以下
+    void set_range_cm(float range_cm) { m_range_cm = range_cm; }
+    // distance_cm の距離にいる顔の幅の予想 (focal_length_px, face_width_cm から。画素)
+    float expected_width_px(float distance_cm) const;
+
+    const FaceTrackerParams& params() const { return m_params; }
+
+private:
+    void associate(const std::vector<cv::Rect>& faces);
+    void select_target();
+    float estimated_distance_cm(const cv::Rect& face) const;
+
+    FaceTrackerParams m_params;
+    std::vector<Track> m_tracks;
+    int m_next_id = 1;
+    int m_target_id = 0; // 0 = 目標なし
+    float m_range_cm = 0.0f;
+
+    // 作業領域 (使い回す)
+    std::vector<double> m_cost;          // トラック×顔のコスト
+    std::vector<int> m_track_face;       // トラックに割り当てた顔 (-1 = なし)
+    std::vector<bool> m_face_used;
+};
+
+// cost (rows×cols, 行優先) の割り当てで合計コストが最小になるものを求める (ハンガリアン法, O(n^3))
+// assignment[row] に割り当てた列を入れる (行が列より多いときは -1 の行がある)
+void solve_assignment(const std::vector<double>& cost, int rows, int cols, std::vector<int>& assignment);
+// 2つの枠の IoU (重なりの面積 / 合わせた面積)
+float rect_iou(const cv::Rect& a, const cv::Rect& b);
+
+// 目標の選び方の名前として正しいか
+bool is_target_policy(const std::string& policy);
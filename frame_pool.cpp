@@ -0,0 +1,78 @@
+#include "frame_pool.hpp"
+
+#include <utility>
+
+FramePool::Handle::Handle(Handle&& other) noexcept
+    : m_pool(std::exchange(other.m_pool, nullptr)), m_index(other.m_index) {}
+
+FramePool::Handle& FramePool::Handle::operator=(Handle&& other) noexcept {
+    if (this != &other) {
+        reset();
+        m_pool = std::exchange(other.m_pool, nullptr);
+        m_index = other.m_index;
+    }
+    return *this;
+}
+
+cv::Mat& FramePool::Handle::image() {
+    return m_pool->m_slots[m_index];
+}
+
+const cv::Mat& FramePool::Handle::image() const {
+    return m_pool->m_slots[m_index];
+}
+
+void FramePool::Handle::reset() {
+    if (m_pool == nullptr) return;
+    m_pool->release(m_index);
+    m_pool = nullptr;
+}
+
+FramePool::FramePool(size_t slot_count, const cv::Size& size, int type)
+    : m_slots(slot_count), m_in_use(new std::atomic<bool>[slot_count]) {
+    for (size_t i = 0; i < slot_count; ++i) {
+        m_slots[i].create(size, type);
+        m_in_use[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+FramePool::FramePool(std::vector<cv::Mat> slots, std::function<void(size_t)> on_release)
+    : m_slots(std::move(slots)), m_in_use(new std::atomic<bool>[m_slots.size()]), m_on_release(std::move(on_release)) {
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_in_use[i].store(false, std::memory_order_relaxed);
+    }
+}
+
+FramePool::Handle FramePool::acquire() {
+    for (size_t n = 0; n < m_slots.size(); ++n) {
+        size_t index = (m_next + n) % m_slots.size();
+        bool expected = false;
+        if (m_in_use[index].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            m_next = (index + 1) % m_slots.size();
+            return Handle(this, index);
+        }
+    }
+    return Handle();
+}
+
+FramePool::Handle FramePool::acquire(size_t index) {
+    bool expected = false;
+    if (index >= m_slots.size() || !m_in_use[index].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        return Handle();
+    }
+    return Handle(this, index);
+}
+
+size_t FramePool::in_use() const {
+    size_t count = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (m_in_use[i].load(std::memory_order_acquire)) ++count;
+    }
+    return count;
+}
+
+void FramePool::release(size_t index) {
+    // 先に空きに戻す (on_release で返したバッファがすぐに acquire(index) されてもよいように)
+    m_in_use[index].store(false, std::memory_order_release);
+    if (m_on_release) m_on_release(index);
+}
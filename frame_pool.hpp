@@ -0,0 +1,72 @@
+#pragma once
+// 使い回しのフレームバッファ (リング)
+//
+// 起動時に決まった数の cv::Mat を確保しておき、キャプチャはその空きスロットに直接書き込む。
+// スロットは Handle で貸し出し、Handle が破棄されると空きに戻る。
+// キュー間では Handle をムーブで渡すだけなので、画素のコピーもヒープ確保も起きない。
+// 外で確保したバッファ (V4L2 の mmap バッファなど) を包んだ cv::Mat をスロットにすることもでき、
+// そのときは Handle が返されるたびに on_release でバッファの持ち主に返す。
+// acquire() は1つのスレッド (キャプチャ) から、Handle の破棄はどのスレッドからでもよい。
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class FramePool {
+public:
+    // 貸し出したスロットへの参照 (ムーブのみ)
+    class Handle {
+    public:
+        Handle() = default;
+        ~Handle() { reset(); }
+        Handle(Handle&& other) noexcept;
+        Handle& operator=(Handle&& other) noexcept;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        explicit operator bool() const { return m_pool != nullptr; }
+        cv::Mat& image();
+        const cv::Mat& image() const;
+        size_t index() const { return m_index; }
+
+        // スロットをプールに返す
+        void reset();
+
+    private:
+        friend class FramePool;
+        Handle(FramePool* pool, size_t index) : m_pool(pool), m_index(index) {}
+
+        FramePool* m_pool = nullptr;
+        size_t m_index = 0;
+    };
+
+    // slot_count 枚の size x type の画像を確保する
+    FramePool(size_t slot_count, const cv::Size& size, int type);
+    // 外で確保した画像をそのままスロットにする (確保はしない)
+    // Handle が返されるたびに、空きに戻してから on_release(index) を呼ぶ (返したスレッドで呼ばれる)
+    FramePool(std::vector<cv::Mat> slots, std::function<void(size_t)> on_release);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // 空きスロットを1つ借りる。すべて使用中なら空の Handle を返す
+    Handle acquire();
+    // index のスロットを借りる。使用中なら空の Handle を返す
+    Handle acquire(size_t index);
+
+    size_t slot_count() const { return m_slots.size(); }
+    // 貸し出し中のスロットの数 (ほかのスレッドが返している途中なら、返す前の数かもしれない)
+    size_t in_use() const;
+
+private:
+    void release(size_t index);
+
+    std::vector<cv::Mat> m_slots;
+    std::unique_ptr<std::atomic<bool>[]> m_in_use;
+    std::function<void(size_t)> m_on_release;
+    size_t m_next = 0; // 次に空きを探し始めるスロット (acquire を呼ぶスレッドだけが触る)
+};
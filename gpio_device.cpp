@@ -0,0 +1,135 @@
+#include "gpio_device.hpp"
+
+#include <chrono>
+#include <csignal>
+
+GpioDevice::GpioDevice() {
+    for (unsigned i = 0; i < MAX_GPIO; ++i) {
+        m_levels[i].store(-1, std::memory_order_relaxed);
+        m_pulses[i].store(-1, std::memory_order_relaxed);
+    }
+}
+
+GpioDevice::~GpioDevice() {
+    stop_timers();
+}
+
+void GpioDevice::terminate() {
+    stop_timers();
+}
+
+int GpioDevice::set_mode(unsigned gpio, GpioMode mode) {
+    if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+    m_levels[gpio].store(-1, std::memory_order_relaxed);
+    m_pulses[gpio].store(-1, std::memory_order_relaxed);
+    return do_set_mode(gpio, mode);
+}
+
+int GpioDevice::write(unsigned gpio, unsigned level) {
+    if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+    int value = level ? 1 : 0;
+    if (m_levels[gpio].exchange(value, std::memory_order_relaxed) == value) {
+        ++m_writes_skipped;
+        return 0;
+    }
+    int result = do_write(gpio, value);
+    if (result < 0) m_levels[gpio].store(-1, std::memory_order_relaxed);
+    ++m_writes_issued;
+    return result;
+}
+
+int GpioDevice::servo(unsigned gpio, unsigned pulse_us) {
+    if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+    int value = static_cast<int>(pulse_us);
+    if (m_pulses[gpio].exchange(value, std::memory_order_relaxed) == value) {
+        ++m_writes_skipped;
+        return 0;
+    }
+    int result = do_servo(gpio, pulse_us);
+    if (result < 0) m_pulses[gpio].store(-1, std::memory_order_relaxed);
+    ++m_writes_issued;
+    ++m_servo_writes;
+    return result;
+}
+
+int GpioDevice::trigger(unsigned gpio, unsigned pulse_us, unsigned level) {
+    if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+    if (pulse_us == 0 || pulse_us > GPIO_MAX_TRIGGER_US) return GPIO_ERROR;
+    int value = level ? 1 : 0;
+    int result = do_trigger(gpio, pulse_us, value);
+    m_levels[gpio].store(result < 0 ? -1 : 1 - value, std::memory_order_relaxed); // 終わると反対のレベル
+    ++m_writes_issued;
+    return result;
+}
+
+int GpioDevice::do_trigger(unsigned gpio, unsigned pulse_us, unsigned level) {
+    int result = do_write(gpio, level);
+    if (result < 0) return result;
+    uint32_t start = tick();
+    while (tick() - start < pulse_us) {} // 10us 程度なので回って待つ (sleep_for では数百 us 行き過ぎることがある)
+    return do_write(gpio, 1 - level);
+}
+
+int GpioDevice::set_timer_func(unsigned timer, unsigned interval_ms, TimerFunc f, void* userdata) {
+    if (timer >= MAX_TIMERS) return GPIO_ERROR;
+    SoftTimer& soft = m_timers[timer];
+
+    // 動いているタイマーは止めてから入れ替える
+    soft.running = false;
+    if (soft.thread.joinable()) soft.thread.join();
+    if (f == nullptr) return 0;
+    if (interval_ms == 0) return GPIO_ERROR;
+
+    soft.running = true;
+    soft.thread = std::thread([&soft, interval_ms, f, userdata] {
+        auto interval = std::chrono::milliseconds(interval_ms);
+        auto next = std::chrono::steady_clock::now() + interval;
+        while (soft.running) {
+            std::this_thread::sleep_until(next);
+            if (!soft.running) break;
+            f(userdata);
+            next += interval;
+        }
+    });
+    return 0;
+}
+
+int GpioDevice::set_signal_func(int signum, SignalFunc f) {
+    return std::signal(signum, f) == SIG_ERR ? GPIO_ERROR : 0;
+}
+
+void GpioDevice::stop_timers() {
+    for (SoftTimer& soft : m_timers) {
+        soft.running = false;
+        if (soft.thread.joinable()) soft.thread.join();
+    }
+}
+
+std::unique_ptr<GpioDevice> make_gpio_device(const std::string& name) {
+#ifdef RAS_EYE_WITH_PIGPIO
+    if (name == "pigpio") return make_pigpio_device();
+#endif
+#ifdef RAS_EYE_WITH_PIGPIOD
+    if (name == "pigpiod") return make_pigpiod_device();
+#endif
+#ifdef RAS_EYE_WITH_LIBGPIOD
+    if (name == "libgpiod") return make_libgpiod_device();
+#endif
+    if (name == "mock") return make_mock_gpio_device();
+    return nullptr;
+}
+
+std::string gpio_device_names() {
+    std::string names;
+#ifdef RAS_EYE_WITH_PIGPIO
+    names += "pigpio, ";
+#endif
+#ifdef RAS_EYE_WITH_PIGPIOD
+    names += "pigpiod, ";
+#endif
+#ifdef RAS_EYE_WITH_LIBGPIOD
+    names += "libgpiod, ";
+#endif
+    names += "mock";
+    return names;
+}
@@ -0,0 +1,121 @@
+#pragma once
+// GPIO デバイスの抽象化 (サーボ・LED・超音波センサー共通)
+//
+// pigpio / pigpiod (ソケット) / libgpiod / ダミー の実装を起動時に選べるようにする。
+// 関数の意味と戻り値は pigpio に合わせてある (0 以上で成功、負の値でエラー)。
+// write() と servo() は前回と同じ値なら実際の書き込みを省略する。
+// trigger() は幅の決まった短いパルスを出す (超音波センサーのトリガー用)。pigpio は DMA の波形、pigpiod はデーモンが
+// 幅を作るので、呼んだスレッドは待たない。その他の実装は tick() を見ながら回って待つ (sleep は行き過ぎるので使わない)。
+//
+// 使える実装はビルド時のフラグで決まる:
+//   RAS_EYE_WITH_PIGPIO   : "pigpio"  (-lpigpio, root 権限が必要)
+//   RAS_EYE_WITH_PIGPIOD  : "pigpiod" (-lpigpiod_if2, pigpiod デーモンに接続。PIGPIO_ADDR/PIGPIO_PORT で接続先を指定)
+//   RAS_EYE_WITH_LIBGPIOD : "libgpiod" (-lgpiod)
+//   (常に使える)          : "mock"    (何もつながっていないダミー。ベンチマーク用)
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum class GpioMode { Input, Output };
+
+// アラート関数の level に渡される値 (pigpio の PI_TIMEOUT と同じ)
+const int GPIO_LEVEL_TIMEOUT = 2;
+// trigger() で出せるパルスの最大幅 (us, pigpio の PI_MAX_PULSELEN と同じ)
+const unsigned GPIO_MAX_TRIGGER_US = 100;
+// 戻り値のエラー
+const int GPIO_ERROR = -1;
+const int GPIO_BAD_PIN = -3;
+
+class GpioDevice {
+public:
+    // pigpio の gpioAlertFuncEx_t / gpioTimerFuncEx_t と同じ形
+    using AlertFunc = void (*)(int gpio, int level, uint32_t tick, void* userdata);
+    using TimerFunc = void (*)(void* userdata);
+    using SignalFunc = void (*)(int signum);
+
+    static const unsigned MAX_GPIO = 54;
+    static const unsigned MAX_TIMERS = 10;
+
+    GpioDevice();
+    virtual ~GpioDevice();
+
+    GpioDevice(const GpioDevice&) = delete;
+    GpioDevice& operator=(const GpioDevice&) = delete;
+
+    virtual const char* name() const = 0;
+
+    // 初期化。失敗したら false
+    virtual bool initialise() = 0;
+    // 終了処理 (タイマーを止めてデバイスを閉じる)
+    virtual void terminate();
+
+    int set_mode(unsigned gpio, GpioMode mode);
+    // 前回と同じ値なら何もしない
+    int write(unsigned gpio, unsigned level);
+    // サーボのパルス幅 (us, 0 で停止)。前回と同じ値なら何もしない
+    int servo(unsigned gpio, unsigned pulse_us);
+    // gpio に level のパルスを pulse_us (1-100us) の間出し、反対のレベルに戻す
+    int trigger(unsigned gpio, unsigned pulse_us, unsigned level = 1);
+    virtual int read(unsigned gpio) = 0;
+
+    // マイクロ秒単位の時刻 (アラート関数に渡される tick と同じ基準)
+    virtual uint32_t tick() = 0;
+
+    // gpio の両エッジで f を呼ぶ (f = nullptr で解除)
+    virtual int set_alert_func(unsigned gpio, AlertFunc f, void* userdata) = 0;
+    // gpio が timeout_ms の間変化しなければ level = GPIO_LEVEL_TIMEOUT でアラート関数を呼ぶ (0 で解除)
+    virtual int set_watchdog(unsigned gpio, unsigned timeout_ms) = 0;
+    // interval_ms ごとに f を呼ぶ (f = nullptr で解除)。既定ではスレッドで呼ぶ
+    virtual int set_timer_func(unsigned timer, unsigned interval_ms, TimerFunc f, void* userdata);
+    // シグナルで f を呼ぶ。既定では std::signal
+    virtual int set_signal_func(int signum, SignalFunc f);
+
+    // 実際に書き込んだ回数と、同じ値だったので省略した回数 (write と servo と trigger の合計)
+    uint64_t writes_issued() const { return m_writes_issued; }
+    uint64_t writes_skipped() const { return m_writes_skipped; }
+    uint64_t servo_writes() const { return m_servo_writes; }
+
+protected:
+    virtual int do_set_mode(unsigned gpio, GpioMode mode) = 0;
+    virtual int do_write(unsigned gpio, unsigned level) = 0;
+    virtual int do_servo(unsigned gpio, unsigned pulse_us) = 0;
+    // 既定: level を書き、tick() で pulse_us 経つまで回って待ってから戻す
+    virtual int do_trigger(unsigned gpio, unsigned pulse_us, unsigned level);
+
+    // 既定のタイマーをすべて止める
+    void stop_timers();
+
+private:
+    struct SoftTimer {
+        std::thread thread;
+        std::atomic<bool> running{false};
+    };
+
+    // 最後に書いた値 (-1 = 不明。モード変更や書き込み失敗で不明に戻す)
+    std::atomic<int> m_levels[MAX_GPIO];
+    std::atomic<int> m_pulses[MAX_GPIO];
+    std::atomic<uint64_t> m_writes_issued{0};
+    std::atomic<uint64_t> m_writes_skipped{0};
+    std::atomic<uint64_t> m_servo_writes{0};
+
+    SoftTimer m_timers[MAX_TIMERS];
+};
+
+// name の実装を作る。知らない名前か、ビルドに含まれていなければ nullptr
+std::unique_ptr<GpioDevice> make_gpio_device(const std::string& name);
+// ビルドに含まれている実装の名前 (表示用, 例: "pigpio, mock")
+std::string gpio_device_names();
+
+#ifdef RAS_EYE_WITH_PIGPIO
+std::unique_ptr<GpioDevice> make_pigpio_device();
+#endif
+#ifdef RAS_EYE_WITH_PIGPIOD
+std::unique_ptr<GpioDevice> make_pigpiod_device();
+#endif
+#ifdef RAS_EYE_WITH_LIBGPIOD
+std::unique_ptr<GpioDevice> make_libgpiod_device();
+#endif
+std::unique_ptr<GpioDevice> make_mock_gpio_device();
@@ -0,0 +1,277 @@
+// libgpiod (/dev/gpiochip0) を使う実装 ("libgpiod")
+//
+// pigpio が使えないカーネルや、root 権限無しで動かしたいときに使う。
+// - エッジはカーネルのタイムスタンプ (CLOCK_MONOTONIC) 付きで受け取る。ピンごとにスレッドで待ち、
+//   ウォッチドッグはその待ちのタイムアウトで作る。
+// - サーボはハードウェアPWMのピン (GPIO12/18 = pwm0, GPIO13/19 = pwm1, dtoverlay=pwm-2chan が必要) なら
+//   /sys/class/pwm を使い、それ以外のピンはスレッドでパルスを作る (ソフトウェアPWM, 多少ぶれる)。
+// libgpiod 1.x の API を使う。
+
+#ifdef RAS_EYE_WITH_LIBGPIOD
+
+#include "gpio_device.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+#include <gpiod.h>
+
+namespace {
+
+const char* CHIP_NAME = "gpiochip0";
+const char* CONSUMER = "ras_eye";
+const char* PWM_CHIP_PATH = "/sys/class/pwm/pwmchip0";
+const unsigned SERVO_PERIOD_US = 20000; // 50Hz
+const unsigned EDGE_POLL_MS = 100;      // ウォッチドッグが無いときに停止フラグを確認する間隔
+
+uint32_t monotonic_us(const timespec& ts) {
+    return static_cast<uint32_t>(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+uint32_t now_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return monotonic_us(ts);
+}
+
+// ハードウェアPWMのチャンネル (使えないピンは -1)
+int pwm_channel(unsigned gpio) {
+    if (gpio == 12 || gpio == 18) return 0;
+    if (gpio == 13 || gpio == 19) return 1;
+    return -1;
+}
+
+bool write_sysfs(const std::string& path, const std::string& value) {
+    std::ofstream file(path);
+    file << value;
+    return static_cast<bool>(file);
+}
+
+class LibgpiodDevice : public GpioDevice {
+public:
+    ~LibgpiodDevice() override { terminate(); }
+
+    const char* name() const override { return "libgpiod"; }
+
+    bool initialise() override {
+        m_chip = gpiod_chip_open_by_name(CHIP_NAME);
+        return m_chip != nullptr;
+    }
+
+    void terminate() override {
+        GpioDevice::terminate();
+        if (m_chip == nullptr) return;
+        for (unsigned gpio = 0; gpio < MAX_GPIO; ++gpio) stop_edge_thread(gpio);
+        stop_soft_pwm();
+        for (unsigned gpio = 0; gpio < MAX_GPIO; ++gpio) {
+            if (m_hw_pwm[gpio]) write_sysfs(pwm_path(gpio, "enable"), "0");
+            m_hw_pwm[gpio] = false;
+            release_line(gpio);
+        }
+        gpiod_chip_close(m_chip);
+        m_chip = nullptr;
+    }
+
+    int read(unsigned gpio) override {
+        if (gpio >= MAX_GPIO || m_lines[gpio] == nullptr) return GPIO_BAD_PIN;
+        return gpiod_line_get_value(m_lines[gpio]);
+    }
+
+    uint32_t tick() override { return now_us(); }
+
+    int set_alert_func(unsigned gpio, AlertFunc f, void* userdata) override {
+        if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+        stop_edge_thread(gpio);
+        if (f == nullptr) return request_input(gpio);
+
+        // エッジイベントを受け取るには入力ではなくイベントとして要求し直す
+        release_line(gpio);
+        m_lines[gpio] = gpiod_chip_get_line(m_chip, gpio);
+        if (m_lines[gpio] == nullptr || gpiod_line_request_both_edges_events(m_lines[gpio], CONSUMER) < 0) {
+            m_lines[gpio] = nullptr;
+            return GPIO_ERROR;
+        }
+
+        EdgeWatcher& watcher = m_watchers[gpio];
+        watcher.running = true;
+        watcher.thread = std::thread(&LibgpiodDevice::edge_loop, this, gpio, f, userdata);
+        return 0;
+    }
+
+    int set_watchdog(unsigned gpio, unsigned timeout_ms) override {
+        if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+        m_watchers[gpio].watchdog_ms = timeout_ms; // 次の待ちから反映される
+        return 0;
+    }
+
+protected:
+    int do_set_mode(unsigned gpio, GpioMode mode) override {
+        stop_edge_thread(gpio);
+        if (mode == GpioMode::Input) return request_input(gpio);
+
+        release_line(gpio);
+        m_lines[gpio] = gpiod_chip_get_line(m_chip, gpio);
+        if (m_lines[gpio] == nullptr || gpiod_line_request_output(m_lines[gpio], CONSUMER, 0) < 0) {
+            m_lines[gpio] = nullptr;
+            return GPIO_ERROR;
+        }
+        return 0;
+    }
+
+    int do_write(unsigned gpio, unsigned level) override {
+        if (m_lines[gpio] == nullptr) return GPIO_BAD_PIN;
+        return gpiod_line_set_value(m_lines[gpio], static_cast<int>(level));
+    }
+
+    int do_servo(unsigned gpio, unsigned pulse_us) override {
+        if (pwm_channel(gpio) >= 0 && (m_hw_pwm[gpio] || enable_hw_pwm(gpio))) {
+            return write_sysfs(pwm_path(gpio, "duty_cycle"), std::to_string(pulse_us * 1000ull)) ? 0 : GPIO_ERROR;
+        }
+        // ハードウェアPWMが使えないピンはソフトウェアPWM (出力として要求済みであること)
+        if (m_lines[gpio] == nullptr) return GPIO_BAD_PIN;
+        std::lock_guard<std::mutex> lock(m_pwm_mutex);
+        auto it = std::find_if(m_soft_pwm.begin(), m_soft_pwm.end(),
+                               [gpio](const SoftPwm& pwm) { return pwm.gpio == gpio; });
+        if (pulse_us == 0) {
+            if (it != m_soft_pwm.end()) m_soft_pwm.erase(it);
+            gpiod_line_set_value(m_lines[gpio], 0);
+            return 0;
+        }
+        if (it == m_soft_pwm.end()) {
+            m_soft_pwm.push_back({gpio, pulse_us});
+        } else {
+            it->pulse_us = pulse_us;
+        }
+        if (!m_pwm_running) {
+            m_pwm_running = true;
+            m_pwm_thread = std::thread(&LibgpiodDevice::soft_pwm_loop, this);
+        }
+        return 0;
+    }
+
+private:
+    struct EdgeWatcher {
+        std::thread thread;
+        std::atomic<bool> running{false};
+        std::atomic<unsigned> watchdog_ms{0};
+    };
+
+    struct SoftPwm {
+        unsigned gpio;
+        unsigned pulse_us;
+    };
+
+    int request_input(unsigned gpio) {
+        release_line(gpio);
+        m_lines[gpio] = gpiod_chip_get_line(m_chip, gpio);
+        if (m_lines[gpio] == nullptr || gpiod_line_request_input(m_lines[gpio], CONSUMER) < 0) {
+            m_lines[gpio] = nullptr;
+            return GPIO_ERROR;
+        }
+        return 0;
+    }
+
+    void release_line(unsigned gpio) {
+        if (m_lines[gpio] == nullptr) return;
+        gpiod_line_release(m_lines[gpio]);
+        m_lines[gpio] = nullptr;
+    }
+
+    void stop_edge_thread(unsigned gpio) {
+        EdgeWatcher& watcher = m_watchers[gpio];
+        watcher.running = false;
+        if (watcher.thread.joinable()) watcher.thread.join();
+    }
+
+    // エッジを待ち、来たらアラート関数を呼ぶ。ウォッチドッグの時間内に来なければ TIMEOUT を渡す
+    void edge_loop(unsigned gpio, AlertFunc f, void* userdata) {
+        EdgeWatcher& watcher = m_watchers[gpio];
+        gpiod_line* line = m_lines[gpio];
+        while (watcher.running) {
+            unsigned watchdog_ms = watcher.watchdog_ms;
+            unsigned wait_ms = watchdog_ms ? watchdog_ms : EDGE_POLL_MS;
+            timespec timeout{static_cast<time_t>(wait_ms / 1000), static_cast<long>(wait_ms % 1000) * 1000000L};
+
+            int result = gpiod_line_event_wait(line, &timeout);
+            if (result < 0) break;
+            if (result == 0) {
+                if (watchdog_ms) f(static_cast<int>(gpio), GPIO_LEVEL_TIMEOUT, now_us(), userdata);
+                continue;
+            }
+            gpiod_line_event event;
+            if (gpiod_line_event_read(line, &event) < 0) break;
+            int level = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE ? 1 : 0;
+            f(static_cast<int>(gpio), level, monotonic_us(event.ts), userdata);
+        }
+    }
+
+    std::string pwm_path(unsigned gpio, const char* file) const {
+        return std::string(PWM_CHIP_PATH) + "/pwm" + std::to_string(pwm_channel(gpio)) + "/" + file;
+    }
+
+    bool enable_hw_pwm(unsigned gpio) {
+        int channel = pwm_channel(gpio);
+        std::string channel_path = std::string(PWM_CHIP_PATH) + "/pwm" + std::to_string(channel);
+        if (access(channel_path.c_str(), F_OK) != 0) {
+            if (!write_sysfs(std::string(PWM_CHIP_PATH) + "/export", std::to_string(channel))) return false;
+        }
+        if (!write_sysfs(pwm_path(gpio, "period"), std::to_string(SERVO_PERIOD_US * 1000ull))) return false;
+        if (!write_sysfs(pwm_path(gpio, "enable"), "1")) return false;
+        // ピンは PWM 機能に切り替わるので、libgpiod の要求は外す
+        release_line(gpio);
+        m_hw_pwm[gpio] = true;
+        return true;
+    }
+
+    // 20ms ごとに全ピンを High にし、パルス幅の短い順に Low に戻す
+    void soft_pwm_loop() {
+        std::vector<SoftPwm> pwms;
+        auto period_start = std::chrono::steady_clock::now();
+        while (m_pwm_running) {
+            {
+                std::lock_guard<std::mutex> lock(m_pwm_mutex);
+                pwms = m_soft_pwm;
+            }
+            std::sort(pwms.begin(), pwms.end(),
+                      [](const SoftPwm& a, const SoftPwm& b) { return a.pulse_us < b.pulse_us; });
+            for (const SoftPwm& pwm : pwms) gpiod_line_set_value(m_lines[pwm.gpio], 1);
+            for (const SoftPwm& pwm : pwms) {
+                std::this_thread::sleep_until(period_start + std::chrono::microseconds(pwm.pulse_us));
+                gpiod_line_set_value(m_lines[pwm.gpio], 0);
+            }
+            period_start += std::chrono::microseconds(SERVO_PERIOD_US);
+            std::this_thread::sleep_until(period_start);
+        }
+    }
+
+    void stop_soft_pwm() {
+        m_pwm_running = false;
+        if (m_pwm_thread.joinable()) m_pwm_thread.join();
+        m_soft_pwm.clear();
+    }
+
+    gpiod_chip* m_chip = nullptr;
+    gpiod_line* m_lines[MAX_GPIO] = {};
+    EdgeWatcher m_watchers[MAX_GPIO];
+    bool m_hw_pwm[MAX_GPIO] = {};
+
+    std::mutex m_pwm_mutex;
+    std::vector<SoftPwm> m_soft_pwm;
+    std::thread m_pwm_thread;
+    std::atomic<bool> m_pwm_running{false};
+};
+
+}
+
+std::unique_ptr<GpioDevice> make_libgpiod_device() {
+    return std::unique_ptr<GpioDevice>(new LibgpiodDevice());
+}
+
+#endif // RAS_EYE_WITH_LIBGPIOD
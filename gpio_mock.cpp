@@ -0,0 +1,62 @@
+// 何もつながっていないダミーの実装 ("mock")
+//
+// 書き込んだ値は覚えておくだけで、出力ピンを読むと最後に書いた値、入力ピンは常に 0。
+// エッジもウォッチドッグも起きないので、アラート関数は呼ばれない。
+// GPIO の無い開発用PCでのベンチマークに使う。
+
+#include "gpio_device.hpp"
+
+#include <chrono>
+
+namespace {
+
+class MockGpioDevice : public GpioDevice {
+public:
+    ~MockGpioDevice() override { terminate(); }
+
+    const char* name() const override { return "mock"; }
+    bool initialise() override { return true; }
+
+    int read(unsigned gpio) override {
+        if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+        return m_outputs[gpio].load(std::memory_order_relaxed);
+    }
+
+    uint32_t tick() override {
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    int set_alert_func(unsigned gpio, AlertFunc f, void* userdata) override {
+        return gpio < MAX_GPIO ? 0 : GPIO_BAD_PIN;
+    }
+    int set_watchdog(unsigned gpio, unsigned timeout_ms) override {
+        return gpio < MAX_GPIO ? 0 : GPIO_BAD_PIN;
+    }
+    // シグナルは本物を使う (Ctrl+C で止められるように)
+
+protected:
+    int do_set_mode(unsigned gpio, GpioMode mode) override {
+        m_outputs[gpio].store(0, std::memory_order_relaxed);
+        return 0;
+    }
+    int do_write(unsigned gpio, unsigned level) override {
+        m_outputs[gpio].store(static_cast<int>(level), std::memory_order_relaxed);
+        return 0;
+    }
+    int do_servo(unsigned gpio, unsigned pulse_us) override { return 0; }
+    int do_trigger(unsigned gpio, unsigned pulse_us, unsigned level) override {
+        m_outputs[gpio].store(level ? 0 : 1, std::memory_order_relaxed); // 待たずに終わったことにする
+        return 0;
+    }
+
+private:
+    std::atomic<int> m_outputs[MAX_GPIO] = {};
+    const std::chrono::steady_clock::time_point m_start = std::chrono::steady_clock::now();
+};
+
+}
+
+std::unique_ptr<GpioDevice> make_mock_gpio_device() {
+    return std::unique_ptr<GpioDevice>(new MockGpioDevice());
+}
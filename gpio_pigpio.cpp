@@ -0,0 +1,101 @@
+// pigpio ライブラリを直接使う実装 ("pigpio")
+// DMA でサーボのパルスを作り、エッジのタイムスタンプもハードウェアの tick なので一番精度が良い。
+// 超音波のトリガーも DMA の波形で出すので、幅が負荷で伸びず、呼んだスレッドも待たない。
+// root 権限が必要で、pigpiod デーモンとは同時に使えない。
+
+#ifdef RAS_EYE_WITH_PIGPIO
+
+#include "gpio_device.hpp"
+
+#include <pigpio.h>
+
+namespace {
+
+class PigpioDevice : public GpioDevice {
+public:
+    ~PigpioDevice() override { terminate(); }
+
+    const char* name() const override { return "pigpio"; }
+
+    bool initialise() override {
+        m_initialised = gpioInitialise() >= 0;
+        return m_initialised;
+    }
+
+    void terminate() override {
+        GpioDevice::terminate();
+        if (m_initialised) gpioTerminate(); // 波形も消える
+        m_initialised = false;
+        for (TriggerWave& wave : m_waves) wave.id = -1;
+    }
+
+    int read(unsigned gpio) override { return gpioRead(gpio); }
+    uint32_t tick() override { return gpioTick(); }
+
+    int set_alert_func(unsigned gpio, AlertFunc f, void* userdata) override {
+        return gpioSetAlertFuncEx(gpio, f, userdata);
+    }
+    int set_watchdog(unsigned gpio, unsigned timeout_ms) override { return gpioSetWatchdog(gpio, timeout_ms); }
+    int set_timer_func(unsigned timer, unsigned interval_ms, TimerFunc f, void* userdata) override {
+        return gpioSetTimerFuncEx(timer, interval_ms, f, userdata);
+    }
+    // pigpio は自分でシグナルを捕まえるので、pigpio 経由で登録する
+    int set_signal_func(int signum, SignalFunc f) override { return gpioSetSignalFunc(signum, f); }
+
+protected:
+    int do_set_mode(unsigned gpio, GpioMode mode) override {
+        return gpioSetMode(gpio, mode == GpioMode::Output ? PI_OUTPUT : PI_INPUT);
+    }
+    int do_write(unsigned gpio, unsigned level) override { return gpioWrite(gpio, level); }
+    int do_servo(unsigned gpio, unsigned pulse_us) override { return gpioServo(gpio, pulse_us); }
+    int do_trigger(unsigned gpio, unsigned pulse_us, unsigned level) override {
+        // 波形が扱えるのはバンク1 (GPIO 0-31) だけ
+        if (gpio > MAX_WAVE_GPIO) return gpioTrigger(gpio, pulse_us, level);
+        int wave = trigger_wave(gpio, pulse_us, level);
+        if (wave < 0) return gpioTrigger(gpio, pulse_us, level); // 波形が作れなければ pigpio の中で待つ
+        return gpioWaveTxSend(wave, PI_WAVE_MODE_ONE_SHOT);
+    }
+
+private:
+    static const unsigned MAX_WAVE_GPIO = 31;
+
+    // ピンごとのトリガーの波形 (幅とレベルが同じ間は作り直さない)
+    struct TriggerWave {
+        int id = -1;
+        unsigned pulse_us = 0;
+        unsigned level = 0;
+    };
+
+    // gpio のトリガーの波形の ID。作れなければ -1 (次に呼ばれたときに作り直す)
+    int trigger_wave(unsigned gpio, unsigned pulse_us, unsigned level) {
+        TriggerWave& wave = m_waves[gpio];
+        if (wave.id >= 0 && wave.pulse_us == pulse_us && wave.level == level) return wave.id;
+        if (wave.id >= 0) gpioWaveDelete(wave.id);
+        wave.id = -1;
+
+        uint32_t bit = 1u << gpio;
+        gpioPulse_t pulses[2] = {
+            {level ? bit : 0, level ? 0 : bit, pulse_us}, // level を pulse_us の間
+            {level ? 0 : bit, level ? bit : 0, 0},        // 反対のレベルに戻す
+        };
+        if (gpioWaveAddNew() < 0) return -1;
+        if (gpioWaveAddGeneric(2, pulses) < 0) return -1;
+        int id = gpioWaveCreate();
+        if (id < 0) return -1;
+        wave.id = id;
+        wave.pulse_us = pulse_us;
+        wave.level = level;
+        return wave.id;
+    }
+
+    bool m_initialised = false;
+    TriggerWave m_waves[MAX_GPIO];
+};
+
+}
+
+std::unique_ptr<GpioDevice> make_pigpio_device() {
+    return std::unique_ptr<GpioDevice>(new PigpioDevice());
+}
+
+#endif // RAS_EYE_WITH_PIGPIO
@@ -0,0 +1,94 @@
+// pigpiod デーモンにソケットで接続する実装 ("pigpiod")
+// root 権限が要らず、pigpiod を使う他のプログラムとも同時に動かせる。
+// コマンドごとにソケットの往復があるぶん遅いが、エッジの tick はデーモン側のハードウェア時刻なので
+// 測距の精度は "pigpio" と変わらない。接続先は環境変数 PIGPIO_ADDR / PIGPIO_PORT で指定する。
+
+#ifdef RAS_EYE_WITH_PIGPIOD
+
+#include "gpio_device.hpp"
+
+#include <pigpiod_if2.h>
+
+namespace {
+
+class PigpiodDevice : public GpioDevice {
+public:
+    ~PigpiodDevice() override { terminate(); }
+
+    const char* name() const override { return "pigpiod"; }
+
+    bool initialise() override {
+        m_pi = pigpio_start(nullptr, nullptr); // PIGPIO_ADDR / PIGPIO_PORT (既定は localhost:8888)
+        return m_pi >= 0;
+    }
+
+    void terminate() override {
+        GpioDevice::terminate();
+        if (m_pi < 0) return;
+        for (Alert& alert : m_alerts) {
+            if (alert.callback_id >= 0) callback_cancel(alert.callback_id);
+            alert.callback_id = -1;
+        }
+        pigpio_stop(m_pi);
+        m_pi = -1;
+    }
+
+    int read(unsigned gpio) override { return gpio_read(m_pi, gpio); }
+    uint32_t tick() override { return get_current_tick(m_pi); }
+
+    int set_alert_func(unsigned gpio, AlertFunc f, void* userdata) override {
+        if (gpio >= MAX_GPIO) return GPIO_BAD_PIN;
+        Alert& alert = m_alerts[gpio];
+        if (alert.callback_id >= 0) {
+            callback_cancel(alert.callback_id);
+            alert.callback_id = -1;
+        }
+        alert.func = f;
+        alert.userdata = userdata;
+        if (f == nullptr) return 0;
+
+        alert.gpio = gpio;
+        int id = callback_ex(m_pi, gpio, EITHER_EDGE, on_callback, &alert);
+        if (id < 0) return id;
+        alert.callback_id = id;
+        return 0;
+    }
+
+    int set_watchdog(unsigned gpio, unsigned timeout_ms) override { return ::set_watchdog(m_pi, gpio, timeout_ms); }
+
+protected:
+    int do_set_mode(unsigned gpio, GpioMode mode) override {
+        return ::set_mode(m_pi, gpio, mode == GpioMode::Output ? PI_OUTPUT : PI_INPUT);
+    }
+    int do_write(unsigned gpio, unsigned level) override { return gpio_write(m_pi, gpio, level); }
+    int do_servo(unsigned gpio, unsigned pulse_us) override { return set_servo_pulsewidth(m_pi, gpio, pulse_us); }
+    // 幅はデーモンの中で作る (こちらはコマンドを1つ送るだけ)
+    int do_trigger(unsigned gpio, unsigned pulse_us, unsigned level) override {
+        return gpio_trigger(m_pi, gpio, pulse_us, level);
+    }
+
+private:
+    struct Alert {
+        unsigned gpio = 0;
+        AlertFunc func = nullptr;
+        void* userdata = nullptr;
+        int callback_id = -1;
+    };
+
+    // pigpiod_if2 のコールバックスレッドで呼ばれる
+    static void on_callback(int pi, unsigned gpio, unsigned level, uint32_t tick, void* userdata) {
+        Alert* alert = static_cast<Alert*>(userdata);
+        if (alert->func) alert->func(static_cast<int>(gpio), static_cast<int>(level), tick, alert->userdata);
+    }
+
+    int m_pi = -1;
+    Alert m_alerts[MAX_GPIO];
+};
+
+}
+
+std::unique_ptr<GpioDevice> make_pigpiod_device() {
+    return std::unique_ptr<GpioDevice>(new PigpiodDevice());
+}
+
+#endif // RAS_EYE_WITH_PIGPIOD
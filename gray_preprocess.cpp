@@ -0,0 +1,220 @@
+#include "gray_preprocess.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 輝度 = (29 B + 150 G + 77 R) / 256 (BT.601 の係数を 8bit の固定小数点にしたもの, 合計 256)
+const unsigned WEIGHT_B = 29;
+const unsigned WEIGHT_G = 150;
+const unsigned WEIGHT_R = 77;
+
+inline uint8_t luma(unsigned b, unsigned g, unsigned r) {
+    return static_cast<uint8_t>((WEIGHT_B * b + WEIGHT_G * g + WEIGHT_R * r + 128) >> 8);
+}
+
+#if defined(__ARM_NEON)
+// BGR 16 画素 → 輝度 16 画素
+inline uint8x16_t luma_1x1(const uint8_t* bgr) {
+    uint8x16x3_t p = vld3q_u8(bgr);
+    uint16x8_t lo = vmull_u8(vget_low_u8(p.val[0]), vdup_n_u8(WEIGHT_B));
+    lo = vmlal_u8(lo, vget_low_u8(p.val[1]), vdup_n_u8(WEIGHT_G));
+    lo = vmlal_u8(lo, vget_low_u8(p.val[2]), vdup_n_u8(WEIGHT_R));
+    uint16x8_t hi = vmull_u8(vget_high_u8(p.val[0]), vdup_n_u8(WEIGHT_B));
+    hi = vmlal_u8(hi, vget_high_u8(p.val[1]), vdup_n_u8(WEIGHT_G));
+    hi = vmlal_u8(hi, vget_high_u8(p.val[2]), vdup_n_u8(WEIGHT_R));
+    return vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8));
+}
+
+// 上下2行の BGR 16 画素ずつ → 2×2 の平均の輝度 8 画素 (色ごとに平均してから重みを掛ける)
+inline uint8x8_t luma_2x2(const uint8_t* top, const uint8_t* bottom) {
+    uint8x16x3_t t = vld3q_u8(top);
+    uint8x16x3_t b = vld3q_u8(bottom);
+    uint16x8_t blue = vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(t.val[0]), b.val[0]), 2);
+    uint16x8_t green = vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(t.val[1]), b.val[1]), 2);
+    uint16x8_t red = vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(t.val[2]), b.val[2]), 2);
+    uint16x8_t y = vmulq_n_u16(blue, WEIGHT_B);
+    y = vmlaq_n_u16(y, green, WEIGHT_G);
+    y = vmlaq_n_u16(y, red, WEIGHT_R);
+    return vrshrn_n_u16(y, 8);
+}
+
+// 上下2行のグレースケール 16 画素ずつ → 2×2 の平均 8 画素
+inline uint8x8_t mean_2x2(const uint8_t* top, const uint8_t* bottom) {
+    return vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(vld1q_u8(top)), vld1q_u8(bottom)), 2);
+}
+#endif
+
+// 出力1行分 (width 画素)。src の y0 行目から downscale 行、x0 画素目から読む
+// NEON で処理しきれなかった右端 (と NEON の無い環境) は普通のループで書く
+void bgr_row(const cv::Mat& src, int y0, int x0, int downscale, int width, uint8_t* out) {
+    int x = 0;
+#if defined(__ARM_NEON)
+    if (downscale == 1) {
+        const uint8_t* in = src.ptr<uint8_t>(y0) + x0 * 3;
+        for (; x + 16 <= width; x += 16) vst1q_u8(out + x, luma_1x1(in + x * 3));
+    } else if (downscale == 2) {
+        const uint8_t* top = src.ptr<uint8_t>(y0) + x0 * 3;
+        const uint8_t* bottom = src.ptr<uint8_t>(y0 + 1) + x0 * 3;
+        for (; x + 16 <= width; x += 16) {
+            vst1q_u8(out + x, vcombine_u8(luma_2x2(top + x * 6, bottom + x * 6),
+                                          luma_2x2(top + x * 6 + 48, bottom + x * 6 + 48)));
+        }
+    }
+#endif
+    const unsigned count = static_cast<unsigned>(downscale * downscale);
+    for (; x < width; ++x) {
+        unsigned b = 0, g = 0, r = 0;
+        for (int dy = 0; dy < downscale; ++dy) {
+            const uint8_t* in = src.ptr<uint8_t>(y0 + dy) + (x0 + x * downscale) * 3;
+            for (int dx = 0; dx < downscale; ++dx, in += 3) {
+                b += in[0];
+                g += in[1];
+                r += in[2];
+            }
+        }
+        out[x] = luma((b + count / 2) / count, (g + count / 2) / count, (r + count / 2) / count);
+    }
+}
+
+void gray_row(const cv::Mat& src, int y0, int x0, int downscale, int width, uint8_t* out) {
+    if (downscale == 1) {
+        std::memcpy(out, src.ptr<uint8_t>(y0) + x0, width);
+        return;
+    }
+    int x = 0;
+#if defined(__ARM_NEON)
+    if (downscale == 2) {
+        const uint8_t* top = src.ptr<uint8_t>(y0) + x0;
+        const uint8_t* bottom = src.ptr<uint8_t>(y0 + 1) + x0;
+        for (; x + 16 <= width; x += 16) {
+            vst1q_u8(out + x, vcombine_u8(mean_2x2(top + x * 2, bottom + x * 2),
+                                          mean_2x2(top + x * 2 + 16, bottom + x * 2 + 16)));
+        }
+    }
+#endif
+    const unsigned count = static_cast<unsigned>(downscale * downscale);
+    for (; x < width; ++x) {
+        unsigned sum = 0;
+        for (int dy = 0; dy < downscale; ++dy) {
+            const uint8_t* in = src.ptr<uint8_t>(y0 + dy) + x0 + x * downscale;
+            for (int dx = 0; dx < downscale; ++dx) sum += in[dx];
+        }
+        out[x] = static_cast<uint8_t>((sum + count / 2) / count);
+    }
+}
+
+// image の縦横 stride 画素ごとの平均。histogram を渡せば、その画素のヒストグラムも入れる
+float sampled_mean(const cv::Mat& image, int stride, GrayHistogram* histogram) {
+    if (histogram) histogram->fill(0);
+    uint64_t sum = 0, count = 0;
+    for (int y = stride / 2; y < image.rows; y += stride) {
+        const uint8_t* row = image.ptr<uint8_t>(y);
+        for (int x = stride / 2; x < image.cols; x += stride) {
+            sum += row[x];
+            ++count;
+            if (histogram) ++(*histogram)[row[x]];
+        }
+    }
+    return count > 0 ? static_cast<float>(sum) / count : 0.0f;
+}
+
+float overlap(const cv::Rect& a, const cv::Rect& b) {
+    float inter = static_cast<float>((a & b).area());
+    float uni = static_cast<float>(a.area() + b.area()) - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+}
+
+void gray_downsample(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst, GrayHistogram* histogram) {
+    if (downscale < 1) downscale = 1;
+    cv::Size size(roi.width / downscale, roi.height / downscale);
+    dst.create(size, CV_8UC1);
+
+    // 同じ値が続くと同じカウンタへの書き込みが詰まるので、4組に分けて数えてから足す
+    uint32_t banks[4][256];
+    if (histogram) std::memset(banks, 0, sizeof(banks));
+
+    const bool bgr = src.type() == CV_8UC3;
+    for (int y = 0; y < size.height; ++y) {
+        uint8_t* out = dst.ptr<uint8_t>(y);
+        if (bgr) {
+            bgr_row(src, roi.y + y * downscale, roi.x, downscale, size.width, out);
+        } else {
+            gray_row(src, roi.y + y * downscale, roi.x, downscale, size.width, out);
+        }
+        if (!histogram) continue;
+        // 書いたばかりの行 (キャッシュに載っている) を数える
+        int x = 0;
+        for (; x + 4 <= size.width; x += 4) {
+            ++banks[0][out[x]];
+            ++banks[1][out[x + 1]];
+            ++banks[2][out[x + 2]];
+            ++banks[3][out[x + 3]];
+        }
+        for (; x < size.width; ++x) ++banks[0][out[x]];
+    }
+    if (histogram) {
+        for (int i = 0; i < 256; ++i) (*histogram)[i] = banks[0][i] + banks[1][i] + banks[2][i] + banks[3][i];
+    }
+}
+
+// cv::equalizeHist と同じ: 最初に現れる階調を 0、累積分布を 0-255 に伸ばす
+void equalization_lut(const GrayHistogram& histogram, cv::Mat& lut) {
+    lut.create(1, 256, CV_8UC1);
+    uint8_t* table = lut.ptr<uint8_t>(0);
+    int first = 0;
+    uint32_t total = 0;
+    for (int i = 0; i < 256; ++i) total += histogram[i];
+    while (first < 256 && histogram[first] == 0) ++first;
+    if (first == 256 || histogram[first] == total) { // 空か、1つの階調しか無い
+        std::memset(table, first == 256 ? 0 : first, 256);
+        return;
+    }
+
+    float scale = 255.0f / (total - histogram[first]);
+    uint32_t sum = 0;
+    std::memset(table, 0, first + 1);
+    for (int i = first + 1; i < 256; ++i) {
+        sum += histogram[i];
+        table[i] = static_cast<uint8_t>(std::min(255, cvRound(sum * scale)));
+    }
+}
+
+void gray_equalize(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst, cv::Mat& lut) {
+    GrayHistogram histogram;
+    gray_downsample(src, roi, downscale, dst, &histogram);
+    equalization_lut(histogram, lut);
+    cv::LUT(dst, lut, dst); // 縮小後の画像にだけ引く
+}
+
+HistogramEqualizer::HistogramEqualizer(const EqualizerParams& params) : m_params(params) {
+    m_params.sample_stride = std::max(1, m_params.sample_stride);
+}
+
+void HistogramEqualizer::apply(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst) {
+    gray_downsample(src, roi, downscale, dst);
+    float mean = sampled_mean(dst, m_params.sample_stride, nullptr);
+    bool refresh = m_lut.empty() || ++m_frames >= m_params.refresh_interval ||
+                   std::abs(mean - m_mean) > m_params.brightness_drift || overlap(roi, m_roi) < m_params.min_overlap;
+    if (refresh) {
+        GrayHistogram histogram;
+        m_mean = sampled_mean(dst, m_params.sample_stride, &histogram);
+        equalization_lut(histogram, m_lut);
+        m_roi = roi;
+        m_frames = 0;
+        ++m_refreshes;
+    }
+    cv::LUT(dst, m_lut, dst);
+}
+
+bool is_preprocess_mode(const std::string& mode) {
+    return mode == "fused" || mode == "cached" || mode == "opencv";
+}
@@ -0,0 +1,70 @@
+#pragma once
+// 顔検出の前処理 (グレースケール化・縮小・ヒストグラム平坦化) を1回の走査で行うカーネル
+//
+// 従来は cvtColor (フレーム全体) → resize (探索範囲) → equalizeHist と、同じ画素を3回読み書きしていた。
+// Raspberry Pi の OpenCV のビルドによっては、これらに NEON のカーネルが入っていないことがある。
+// gray_downsample() は探索範囲 (ROI) の BGR かグレースケールの画素を1回だけ読み、
+// downscale × downscale 画素の平均の輝度を書きながら、同じループでヒストグラムも数える。
+// 平坦化は、そのヒストグラムから作った LUT (equalizeHist と同じ計算) を縮小後の画像に引くだけ。
+// ARM (NEON) では downscale 1 と 2 を 16 画素ずつまとめて処理する。それ以外は普通のループ。
+// 追跡中は ROI だけを渡せば、その範囲だけを変換・平坦化する。
+//
+// カメラが固定なら明るさの分布はフレームごとにほとんど変わらないので、HistogramEqualizer は LUT を持ち回し、
+// refresh_interval フレームごと (か、平均の明るさが変わったとき・探す範囲が変わったとき) にだけ
+// 間引いたヒストグラムから作り直す。それ以外のフレームは縮小と cv::LUT の1回ずつで済む。
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+// 輝度のヒストグラム (256 階調)
+using GrayHistogram = std::array<uint32_t, 256>;
+
+// src (CV_8UC3 の BGR か CV_8UC1) の roi を downscale 分の1に縮小した輝度を dst (CV_8UC1) に書く
+// dst の大きさは roi.width / downscale × roi.height / downscale (割り切れない端の画素は使わない)。
+// dst がすでにその大きさなら確保し直さない (確保済みのバッファの一部を渡してよい)
+// histogram を渡せば、書いた画素のヒストグラムを入れる (0 から数え直す)
+void gray_downsample(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst,
+                     GrayHistogram* histogram = nullptr);
+
+// histogram を平坦にする LUT (1×256, CV_8UC1) を lut に作る。cv::equalizeHist と同じ値になる
+void equalization_lut(const GrayHistogram& histogram, cv::Mat& lut);
+
+// gray_downsample() → equalization_lut() → cv::LUT をまとめたもの (lut は作業領域, 使い回す)
+void gray_equalize(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst, cv::Mat& lut);
+
+// LUT を持ち回す平坦化の調整値 (要調整)
+struct EqualizerParams {
+    int refresh_interval = 15;      // このフレーム数ごとに LUT を作り直す
+    int sample_stride = 4;          // 作り直すときのヒストグラムと平均の明るさは縦横この画素ごとに数える
+    float brightness_drift = 8.0f;  // 平均の明るさ (0-255) が LUT を作ったときからこれだけ変わったら作り直す
+    float min_overlap = 0.5f;       // 探す範囲が LUT を作ったときの範囲とこの割合 (IoU) 未満しか重ならなければ作り直す
+};
+
+// LUT を持ち回すヒストグラム平坦化。1つのスレッドからだけ使うこと
+class HistogramEqualizer {
+public:
+    explicit HistogramEqualizer(const EqualizerParams& params = EqualizerParams());
+
+    // gray_equalize() と同じ (src の roi を縮小した輝度を dst に書いて平坦化する) が、LUT は必要なときだけ作る
+    void apply(const cv::Mat& src, const cv::Rect& roi, int downscale, cv::Mat& dst);
+    // 次の apply() で必ず作り直す
+    void reset() { m_lut.release(); }
+
+    // LUT を作り直した回数
+    uint64_t refreshes() const { return m_refreshes; }
+
+private:
+    EqualizerParams m_params;
+    cv::Mat m_lut;
+    cv::Rect m_roi;              // LUT を作ったときの範囲
+    float m_mean = 0.0f;         // そのときの平均の明るさ
+    int m_frames = 0;            // LUT を作ってからのフレーム数
+    uint64_t m_refreshes = 0;
+};
+
+// 前処理の方法の名前として正しいか
+// ("fused": gray_equalize(), "cached": HistogramEqualizer, "opencv": cvtColor → resize → equalizeHist)
+bool is_preprocess_mode(const std::string& mode);
@@ -0,0 +1,91 @@
+#include "http_util.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int http_listen(const char* name, const std::string& address, int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "ERROR: " << name << ": socket failed: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)); // 再起動してすぐ同じポートを使う
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "ERROR: " << name << ": invalid address [" << address << "]\n";
+        ::close(fd);
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 4) < 0) {
+        std::cerr << "ERROR: " << name << ": could not listen on " << address << ":" << port << ": "
+                  << std::strerror(errno) << "\n";
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int http_accept(int socket, int poll_ms, std::chrono::milliseconds timeout) {
+    pollfd fd{socket, POLLIN, 0};
+    if (::poll(&fd, 1, poll_ms) <= 0) return -1;
+    int client = ::accept(socket, nullptr, nullptr);
+    if (client < 0) return -1;
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return client;
+}
+
+bool http_read_request(int client, HttpRequest& request) {
+    char buffer[1024];
+    size_t length = 0;
+    while (length < sizeof(buffer) - 1) {
+        ssize_t n = ::recv(client, buffer + length, sizeof(buffer) - 1 - length, 0);
+        if (n <= 0) break;
+        length += static_cast<size_t>(n);
+        buffer[length] = '\0';
+        if (std::strstr(buffer, "\r\n\r\n") || std::strstr(buffer, "\n\n")) break;
+    }
+    buffer[length] = '\0';
+
+    // "METHOD PATH VERSION"
+    const char* method_end = std::strchr(buffer, ' ');
+    if (!method_end) return false;
+    const char* path = method_end + 1;
+    size_t path_length = std::strcspn(path, " ?\r\n");
+    if (path_length == 0) return false;
+    request.method.assign(buffer, static_cast<size_t>(method_end - buffer));
+    request.path.assign(path, path_length);
+    return true;
+}
+
+bool http_send_all(int client, const char* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(client, data + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool http_send_all(int client, const std::string& data) {
+    return http_send_all(client, data.data(), data.size());
+}
+
+bool http_send_status(int client, const char* status) {
+    return http_send_all(client, std::string("HTTP/1.0 ") + status + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+}
@@ -0,0 +1,29 @@
+#pragma once
+// 小さな HTTP/1.0 サーバーの共通部分 (metrics.cpp の /metrics と preview.cpp の MJPEG が使う)
+//
+// どちらも 1 つのスレッドで accept して、リクエスト行だけを見て応答する。ここにあるのはその下回り
+// (待ち受けのソケット・接続の受け付け・リクエスト行の読み取り・送信) だけで、スレッドは持たない。
+// name はエラーの表示に使う ("metrics", "preview" など)。
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// address:port で待ち受ける TCP のソケットを作る。失敗したら ERROR を出して -1
+int http_listen(const char* name, const std::string& address, int port);
+// 接続を poll_ms だけ待って受け付け、送受信に timeout を設定する。来なければ -1
+int http_accept(int socket, int poll_ms, std::chrono::milliseconds timeout);
+
+// リクエスト行 ("GET /metrics HTTP/1.1")
+struct HttpRequest {
+    std::string method; // "GET" など
+    std::string path;   // "?" から後 (クエリ) は除く
+};
+// リクエストを読む (ヘッダーは読み捨てる)。リクエスト行が読めなければ false
+bool http_read_request(int client, HttpRequest& request);
+
+// 全部送るまで繰り返す。送れなければ (相手が閉じた・遅すぎる) false
+bool http_send_all(int client, const char* data, size_t size);
+bool http_send_all(int client, const std::string& data);
+// 本文の無い応答を返す。status は "404 Not Found" など
+bool http_send_status(int client, const char* status);
@@ -0,0 +1,199 @@
+#include "log.hpp"
+
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* level_prefix(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG: ";
+    case LogLevel::Warning: return "WARNING: ";
+    case LogLevel::Error: return "ERROR: ";
+    default: return "";
+    }
+}
+
+}
+
+Logger::Logger() : m_slots(new Slot[CAPACITY]) {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+    for (size_t i = 0; i < CAPACITY; ++i) m_slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+Logger::~Logger() {
+    stop();
+}
+
+void Logger::start(const LogParams& params) {
+    if (m_running) return;
+    m_min_level.store(params.min_level, std::memory_order_relaxed);
+    m_min_interval_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(params.min_interval).count(),
+                            std::memory_order_relaxed);
+    m_flush_interval = params.flush_interval;
+    m_running = true;
+    m_thread = std::thread(&Logger::run, this);
+}
+
+void Logger::stop() {
+    if (m_thread.joinable()) {
+        m_running = false;
+        m_thread.join();
+    }
+    std::string out, err;
+    drain(out, err); // スレッドが止まった後に書かれた分 (start() していなければ全部)
+}
+
+void Logger::push(LogLevel level, const char* format, const LogArg* args, size_t count) {
+    uint32_t suppressed = 0;
+    if (!admit(format, suppressed)) return;
+
+    // 枠を1つ取る (Vyukov の有界キュー。seq == pos なら空き、pos より小さければ一杯)
+    size_t pos = m_head.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &m_slots[pos & (CAPACITY - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed); // 書き出しが追いつかない: 待たずに捨てる
+            return;
+        } else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+    Record& record = slot->record;
+    record.format = format;
+    record.level = level;
+    record.arg_count = static_cast<uint8_t>(count);
+    record.suppressed = suppressed;
+    for (size_t i = 0; i < count; ++i) record.args[i] = args[i];
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::admit(const char* format, uint32_t& suppressed) {
+    int64_t interval = m_min_interval_ns.load(std::memory_order_relaxed);
+    if (interval <= 0) return true;
+
+    size_t hash = (reinterpret_cast<uintptr_t>(format) >> 3) * 0x9E3779B97F4A7C15ull >> 32;
+    for (size_t probe = 0; probe < 8; ++probe) {
+        RateSlot& rate = m_rate[(hash + probe) % RATE_SLOTS];
+        const char* key = rate.format.load(std::memory_order_acquire);
+        if (key == nullptr && !rate.format.compare_exchange_strong(key, format, std::memory_order_acq_rel)) {
+            if (key != format) continue; // 他の書式が先に入った
+        } else if (key != nullptr && key != format) {
+            continue;
+        }
+
+        int64_t now = now_ns();
+        int64_t next = rate.next_ns.load(std::memory_order_relaxed);
+        if (now < next || !rate.next_ns.compare_exchange_strong(next, now + interval, std::memory_order_relaxed)) {
+            rate.suppressed.fetch_add(1, std::memory_order_relaxed); // 間隔内か、同時に他のスレッドが書いた
+            m_suppressed_total.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = rate.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    return true; // 表が一杯なら間引かない
+}
+
+bool Logger::pop(Record& record) {
+    Slot& slot = m_slots[m_tail & (CAPACITY - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != m_tail + 1) return false; // 空か、書き込み中
+    record = slot.record;
+    slot.seq.store(m_tail + CAPACITY, std::memory_order_release); // 1周後の書き込みに空ける
+    ++m_tail;
+    return true;
+}
+
+void Logger::run() {
+    std::string out, err; // 使い回す (書き出していない間は確保し直さない)
+    while (m_running) {
+        std::this_thread::sleep_for(m_flush_interval);
+        drain(out, err);
+    }
+}
+
+void Logger::drain(std::string& out, std::string& err) {
+    out.clear();
+    err.clear();
+    Record record;
+    while (pop(record)) format_record(record, record.level >= LogLevel::Warning ? err : out);
+
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reported_dropped) {
+        err += "WARNING: log: " + std::to_string(dropped - m_reported_dropped) + " messages dropped (ring buffer full)\n";
+        m_reported_dropped = dropped;
+    }
+    // まとめて1回ずつ書いて flush する
+    if (!out.empty()) std::cout.write(out.data(), static_cast<std::streamsize>(out.size())).flush();
+    if (!err.empty()) std::cerr.write(err.data(), static_cast<std::streamsize>(err.size())).flush();
+}
+
+void Logger::format_record(const Record& record, std::string& line) {
+    line += level_prefix(record.level);
+    char number[64];
+    size_t next_arg = 0;
+    for (const char* p = record.format; *p; ++p) {
+        // {} か {.N} (N は1桁)
+        int precision = -1;
+        size_t length = 0;
+        if (p[0] == '{' && p[1] == '}') {
+            length = 2;
+        } else if (p[0] == '{' && p[1] == '.' && p[2] >= '0' && p[2] <= '9' && p[3] == '}') {
+            precision = p[2] - '0';
+            length = 4;
+        }
+        if (length == 0 || next_arg >= record.arg_count) {
+            line += *p;
+            continue;
+        }
+        const LogArg& arg = record.args[next_arg++];
+        switch (arg.type) {
+        case LogArg::Type::Int:
+            line += std::to_string(arg.i);
+            break;
+        case LogArg::Type::Float:
+            if (precision >= 0) {
+                std::snprintf(number, sizeof(number), "%.*f", precision, arg.f);
+            } else {
+                std::snprintf(number, sizeof(number), "%g", arg.f);
+            }
+            line += number;
+            break;
+        case LogArg::Type::Text:
+            line += arg.text;
+            break;
+        }
+        p += length - 1;
+    }
+    if (record.suppressed > 0) line += " (" + std::to_string(record.suppressed) + " similar messages suppressed)";
+    line += '\n';
+}
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+bool parse_log_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") {
+        level = LogLevel::Debug;
+    } else if (name == "info") {
+        level = LogLevel::Info;
+    } else if (name == "warning") {
+        level = LogLevel::Warning;
+    } else if (name == "error") {
+        level = LogLevel::Error;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+#pragma once
+// 非同期のログ (追跡のスレッドが表示の書き込みで待たないように)
+//
+// logger().info("Distance: {.1} cm", distance) のように呼ぶと、書式の文字列のポインタと引数 (数値か文字列のポインタ) を
+// 固定長のレコードにしてロックの無いリングバッファに入れるだけで、すぐ返る (ヒープも確保しない)。
+// バックグラウンドのスレッドが flush_interval ごとにまとめて取り出し、文字列にしてから一度に書き出す
+// (SD カードの journald に1行ずつ flush しない)。リングが一杯ならそのレコードは捨てて数だけ数える。
+// - 書式の {} は引数に置き換わる。{.N} は小数点以下 N 桁 (整数の引数はそのまま)
+// - 書式と文字列の引数は、書き出されるまで消えないもの (文字列リテラル・グローバルの持つ文字列) だけを渡すこと
+// - min_level より低いレベルは何もしない (atomic を1つ読むだけ)
+// - 同じ書式 (呼び出し元) のメッセージは min_interval に1回まで。間引いた数は次に書くときに付ける
+// DEBUG / INFO は標準出力、WARNING / ERROR は標準エラーに書く (頭に "DEBUG: " などを付ける。INFO は何も付けない)。
+// 起動時・終了時のエラー (設定の誤りなど) は、これまでどおり std::cerr に直接書いてよい。
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+};
+
+// ログの調整値
+struct LogParams {
+    LogLevel min_level = LogLevel::Info;               // これより低いレベルは書かない
+    std::chrono::milliseconds min_interval{200};       // 同じ書式のメッセージはこの間隔に1回まで (0 で間引かない)
+    std::chrono::milliseconds flush_interval{50};      // バックグラウンドのスレッドが書き出す間隔
+};
+
+// レコードに入れる引数 (整数・小数・文字列のポインタ)
+struct LogArg {
+    enum class Type : uint8_t { Int, Float, Text };
+    Type type = Type::Int;
+    union {
+        int64_t i;
+        double f;
+        const char* text;
+    };
+
+    LogArg() : i(0) {}
+    LogArg(int value) : type(Type::Int), i(value) {}
+    LogArg(unsigned value) : type(Type::Int), i(value) {}
+    LogArg(long value) : type(Type::Int), i(value) {}
+    LogArg(unsigned long value) : type(Type::Int), i(static_cast<int64_t>(value)) {}
+    LogArg(long long value) : type(Type::Int), i(value) {}
+    LogArg(unsigned long long value) : type(Type::Int), i(static_cast<int64_t>(value)) {}
+    LogArg(float value) : type(Type::Float), f(value) {}
+    LogArg(double value) : type(Type::Float), f(value) {}
+    LogArg(const char* value) : type(Type::Text), text(value ? value : "(null)") {}
+};
+
+class Logger {
+public:
+    static const size_t MAX_ARGS = 6;
+    static const size_t CAPACITY = 1024; // リングバッファのレコード数 (2のべき乗。flush_interval の間に溜まる分より十分多く)
+
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // バックグラウンドのスレッドを始める。start() の前に書いたものは start() の後で書き出す (リングに入る分だけ)
+    void start(const LogParams& params = LogParams());
+    // 残っているレコードをすべて書き出してからスレッドを止める (start() していなければ呼んだスレッドで書き出す)
+    void stop();
+
+    void set_min_level(LogLevel level) { m_min_level.store(level, std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= m_min_level.load(std::memory_order_relaxed); }
+
+    // format の {} を args で置き換えて書く。待たない (どのスレッドから呼んでもよい)
+    template <typename... Args>
+    void write(LogLevel level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+        if (!enabled(level)) return;
+        const LogArg packed[] = {LogArg(), LogArg(args)...};
+        push(level, format, packed + 1, sizeof...(Args));
+    }
+    template <typename... Args> void debug(const char* format, const Args&... args) { write(LogLevel::Debug, format, args...); }
+    template <typename... Args> void info(const char* format, const Args&... args) { write(LogLevel::Info, format, args...); }
+    template <typename... Args> void warning(const char* format, const Args&... args) { write(LogLevel::Warning, format, args...); }
+    template <typename... Args> void error(const char* format, const Args&... args) { write(LogLevel::Error, format, args...); }
+
+    // リングが一杯で捨てたレコードの数と、間引いたレコードの数
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t suppressed() const { return m_suppressed_total.load(std::memory_order_relaxed); }
+
+private:
+    struct Record {
+        const char* format;
+        LogLevel level;
+        uint8_t arg_count;
+        uint32_t suppressed; // この書式で直前に間引いた数
+        std::array<LogArg, MAX_ARGS> args;
+    };
+    // リングの1枠 (seq で書き込み中・読み出し可能を見分ける)
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        Record record;
+    };
+    // 書式ごとの間引きの状態 (書式のポインタで引く小さなハッシュ表)
+    struct RateSlot {
+        std::atomic<const char*> format{nullptr};
+        std::atomic<int64_t> next_ns{0};       // これより前のメッセージは間引く
+        std::atomic<uint32_t> suppressed{0};
+    };
+    static const size_t RATE_SLOTS = 128;
+
+    void push(LogLevel level, const char* format, const LogArg* args, size_t count);
+    // 書いてよければ true。間引いていた数を suppressed に入れる
+    bool admit(const char* format, uint32_t& suppressed);
+    bool pop(Record& record);
+    void run();
+    void drain(std::string& out, std::string& err);
+    static void format_record(const Record& record, std::string& line);
+
+    std::atomic<LogLevel> m_min_level{LogLevel::Info};
+    std::atomic<int64_t> m_min_interval_ns{200000000};
+    std::chrono::milliseconds m_flush_interval{50};
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<size_t> m_head{0}; // 次に書く位置 (どのスレッドも書く)
+    size_t m_tail = 0;             // 次に読む位置 (バックグラウンドのスレッドだけ)
+
+    std::array<RateSlot, RATE_SLOTS> m_rate;
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_suppressed_total{0};
+    uint64_t m_reported_dropped = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+};
+
+// プログラム全体で共有するログ (ras_eye.cpp の main() が start() / stop() する)
+Logger& logger();
+
+// レベルの名前 ("debug", "info", "warning", "error") を読む。正しい名前なら true
+bool parse_log_level(const std::string& name, LogLevel& level);
@@ -0,0 +1,131 @@
+#include "metrics.hpp"
+
+#include <cstdio>
+
+#include <unistd.h>
+
+#include "http_util.hpp"
+
+namespace {
+
+const int ACCEPT_POLL_MS = 200; // 停止フラグを確かめる間隔
+
+std::string format_double(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+}
+
+// --- MetricsWriter ---
+
+void MetricsWriter::describe(const char* name, const char* type, const char* help) {
+    m_text += "# HELP ";
+    m_text += name;
+    m_text += ' ';
+    m_text += help;
+    m_text += "\n# TYPE ";
+    m_text += name;
+    m_text += ' ';
+    m_text += type;
+    m_text += '\n';
+}
+
+void MetricsWriter::line(const char* name, const char* suffix, const std::string& labels, const std::string& value) {
+    m_text += name;
+    m_text += suffix;
+    if (!labels.empty()) {
+        m_text += '{';
+        m_text += labels;
+        m_text += '}';
+    }
+    m_text += ' ';
+    m_text += value;
+    m_text += '\n';
+}
+
+void MetricsWriter::sample(const char* name, const std::string& labels, double value) {
+    line(name, "", labels, format_double(value));
+}
+
+void MetricsWriter::sample(const char* name, const std::string& labels, uint64_t value) {
+    line(name, "", labels, std::to_string(value));
+}
+
+void MetricsWriter::histogram(const char* name, const std::string& labels, const CumulativeHistogram::Snapshot& histogram) {
+    // Prometheus のバケツは「le 以下の数」の累積
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < CumulativeHistogram::BUCKET_COUNT; ++i) {
+        cumulative += histogram.buckets[i];
+        line(name, "_bucket", prefix + "le=\"" + format_double(CumulativeHistogram::BOUNDS_US[i] / 1e6) + "\"",
+             std::to_string(cumulative));
+    }
+    cumulative += histogram.buckets[CumulativeHistogram::BUCKET_COUNT];
+    line(name, "_bucket", prefix + "le=\"+Inf\"", std::to_string(cumulative));
+    line(name, "_sum", labels, format_double(histogram.sum_us / 1e6));
+    // record() と並行すると count とバケツの合計がずれることがあるので、バケツの合計を count とする
+    line(name, "_count", labels, std::to_string(cumulative));
+}
+
+// --- MetricsServer ---
+
+MetricsServer::MetricsServer(const MetricsParams& params) : m_params(params) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(Collect collect) {
+    if (m_params.port <= 0 || running()) return true;
+    m_collect = std::move(collect);
+
+    m_socket = http_listen("metrics", m_params.address, m_params.port);
+    if (m_socket < 0) return false;
+
+    m_running = true;
+    m_thread = std::thread(&MetricsServer::run, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!m_thread.joinable()) return;
+    m_running = false;
+    m_thread.join();
+    ::close(m_socket);
+    m_socket = -1;
+}
+
+void MetricsServer::run() {
+    while (m_running) {
+        int client = http_accept(m_socket, ACCEPT_POLL_MS, m_params.recv_timeout);
+        if (client < 0) continue;
+        serve(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::serve(int client) {
+    // リクエスト行 ("GET /metrics HTTP/1.1") だけを見る
+    HttpRequest request;
+    if (!http_read_request(client, request)) {
+        http_send_status(client, "400 Bad Request");
+        return;
+    }
+    if (request.method != "GET") {
+        http_send_status(client, "405 Method Not Allowed");
+        return;
+    }
+    if (request.path != "/metrics") {
+        http_send_status(client, "404 Not Found");
+        return;
+    }
+
+    m_writer.clear();
+    m_collect(m_writer);
+    std::string header = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                         std::to_string(m_writer.text().size()) + "\r\nConnection: close\r\n\r\n";
+    if (http_send_all(client, header)) http_send_all(client, m_writer.text());
+    ++m_scrapes;
+}
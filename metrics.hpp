@@ -0,0 +1,79 @@
+#pragma once
+// 状態を外から見るための Prometheus の /metrics (HTTP)
+//
+// MetricsServer は自分のスレッドで port を待ち受け、GET /metrics が来るたびに collect を呼んで
+// Prometheus のテキスト形式 (version 0.0.4) を返す。collect は各部がすでに持っている atomic のカウンタと
+// StageStats の累積のヒストグラムを読むだけなので、計測する側 (追跡のスレッド) は何も待たない。
+// 接続は1つずつ処理して、返したら閉じる (相手が遅くても recv_timeout で諦める)。
+// port が 0 なら start() は何もしない (既定は無効。設定ファイルの metrics_port で有効にする)。
+//
+// 例: curl http://raspberrypi.local:9110/metrics
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "stage_stats.hpp"
+
+// Prometheus のテキスト形式を組み立てる
+// 1つのメトリクスにつき describe() を1回呼んでから、ラベル違いの値を sample() / histogram() で足す
+class MetricsWriter {
+public:
+    // type は "counter", "gauge", "histogram"
+    void describe(const char* name, const char* type, const char* help);
+    // labels は {} の中身 (例: "stage=\"detect\"")。無ければ空
+    void sample(const char* name, const std::string& labels, double value);
+    void sample(const char* name, const std::string& labels, uint64_t value);
+    // us 単位のヒストグラムを秒で書く (name_bucket{le=...}, name_sum, name_count)
+    void histogram(const char* name, const std::string& labels, const CumulativeHistogram::Snapshot& histogram);
+
+    const std::string& text() const { return m_text; }
+    void clear() { m_text.clear(); }
+
+private:
+    void line(const char* name, const char* suffix, const std::string& labels, const std::string& value);
+
+    std::string m_text;
+};
+
+struct MetricsParams {
+    int port = 0;                            // 待ち受ける TCP のポート (0 = 無効)
+    std::string address = "0.0.0.0";         // 待ち受けるアドレス (127.0.0.1 にすればこの機械からだけ)
+    std::chrono::milliseconds recv_timeout{1000}; // リクエストを待つ時間の上限
+};
+
+class MetricsServer {
+public:
+    using Collect = std::function<void(MetricsWriter&)>;
+
+    explicit MetricsServer(const MetricsParams& params = MetricsParams());
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 待ち受けを始める。collect はこのサーバーのスレッドから呼ばれる。失敗したら false (エラーを表示する)
+    bool start(Collect collect);
+    void stop();
+
+    bool running() const { return m_thread.joinable(); }
+    // 返した /metrics の数
+    uint64_t scrapes() const { return m_scrapes; }
+
+    const MetricsParams& params() const { return m_params; }
+
+private:
+    void run();
+    void serve(int client);
+
+    MetricsParams m_params;
+    Collect m_collect;
+    int m_socket = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_scrapes{0};
+    MetricsWriter m_writer; // 使い回す (サーバーのスレッドだけが使う)
+};
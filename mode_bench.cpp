@@ -0,0 +1,294 @@
+// bench モード: 録画した映像で顔検出とパン・チルト制御の速さを測るベンチマーク
+//
+// track モードと同じ FaceDetector / PanTiltController に、動画ファイルか画像フォルダのフレームを
+// 順番に流して、処理速度 (fps)・1フレームあたりの処理時間の分布・顔の検出率を表示する。
+// GPIO はダミー (gpio_mock.cpp) を使うので、カメラも Raspberry Pi も無い PC で動く。
+// 同じ映像で測れば、コミット間の比較ができる。
+//
+// 検出エンジンは --detector=NAME で選ぶ。--detector=all で使えるものを全部、同じ映像で順に測る。
+// --detect-threads=N で haar / lbp を N スレッドで並列に探す (結果の detect_threads= に出る)。
+// --target=sticky|largest|closest で複数の顔から追う顔の選び方を変える (target_switches= は目標が変わった回数)。
+// --preprocess=fused|cached|opencv でグレースケールのエンジンの前処理を選ぶ (gray_preprocess.hpp のカーネル、
+// その LUT を持ち回すもの、従来の cvtColor → resize → equalizeHist)。--preprocess=all で全部を同じ映像で順に測る
+// (Preprocess 段の時間を比べる。lut_refreshes= は cached で LUT を作り直した回数)。
+// --gray でグレースケールのフレームを流す (--camera=v4l2 のときと同じ経路を測る)。
+// 動き検出による間引き (MotionGate) も track モードと同じように通す。--no-motion-gate で毎フレーム検出する。
+//
+// 検出器・サーボの調整値は track モードと同じ設定ファイルから読む (引数があればそちらを使う)。
+//
+// 使い方: ./ras_eye bench <動画ファイル | 画像フォルダ> [最大フレーム数] [--config=PATH] [--detector=haar|lbp|yunet|ssd|all] [--gray]
+//                         [--no-motion-gate] [--detect-threads=N] [--target=POLICY] [--preprocess=fused|cached|opencv|all]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "face_detector.hpp"
+#include "gpio_device.hpp"
+#include "gray_preprocess.hpp"
+#include "modes.hpp"
+#include "motion_gate.hpp"
+#include "nose_locator.hpp"
+#include "pan_tilt.hpp"
+#include "servo_output.hpp"
+#include "settings.hpp"
+#include "stage_stats.hpp"
+
+namespace {
+
+// フレームは track モードのカメラと同じ解像度 (CAMERA_WIDTH × CAMERA_HEIGHT, settings.hpp) に揃えて流す
+const int WARMUP_FRAMES = 3; // 最初の数フレームは統計に入れない (初回のバッファ確保などを除く)
+
+// 動画ファイルまたは画像フォルダからフレームを順番に読む
+class ReplaySource {
+public:
+    bool open(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            std::vector<std::string> files;
+            cv::glob(path + "/*", files, false);
+            for (const std::string& file : files) {
+                if (is_image_file(file)) m_files.push_back(file);
+            }
+            std::sort(m_files.begin(), m_files.end()); // ファイル名順に流す
+            return !m_files.empty();
+        }
+        return m_video.open(path);
+    }
+
+    bool read(cv::Mat& frame) {
+        if (m_files.empty()) return m_video.read(frame) && !frame.empty();
+        if (m_next_file >= m_files.size()) return false;
+        frame = cv::imread(m_files[m_next_file++], cv::IMREAD_COLOR);
+        return !frame.empty();
+    }
+
+private:
+    static bool is_image_file(const std::string& file) {
+        std::string ext = file.substr(file.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp" || ext == "pgm" || ext == "ppm";
+    }
+
+    cv::VideoCapture m_video;
+    std::vector<std::string> m_files;
+    size_t m_next_file = 0;
+};
+
+// engine の検出器で source_path を最後まで (または max_frames まで) 流して結果を表示する。失敗したら false
+// gray なら、--camera=v4l2 と同じくグレースケール (Y 面) のフレームとして流す (変換は計測に含めない)
+// use_motion_gate なら、動きの無いフレームでは検出を飛ばす・前回の結果を使う (使い回しは検出として数える)
+bool bench_engine(const Config& config, const std::string& source_path, long max_frames, const std::string& engine,
+                  int detect_threads, const std::string& target_policy, const std::string& preprocess, bool gray,
+                  bool use_motion_gate) {
+    ReplaySource source;
+    if (!source.open(source_path)) {
+        std::cerr << "ERROR: Could not open replay source [" << source_path << "]\n";
+        return false;
+    }
+
+    StageStats stats;
+    FaceDetector detector(face_detector_params(config));
+    detector.set_engine(engine);
+    detector.set_detect_threads(detect_threads);
+    detector.set_target_policy(target_policy);
+    detector.set_preprocess(preprocess);
+    if (!detector.load()) {
+        std::cerr << "ERROR: Could not load face detector " << detector.engine_description() << "\n";
+        return false;
+    }
+    NoseLocator nose_locator;
+    bool landmarks = nose_locator.load(); // モデルが無ければ顔の中心で測る
+
+    std::unique_ptr<GpioDevice> gpio = make_mock_gpio_device();
+    gpio->initialise();
+    PanTiltController pan_tilt(pan_tilt_params(config));
+    ServoOutput servo_output(servo_output_params(config));
+    servo_output.init(*gpio);
+    pan_tilt.init(servo_output);
+    uint64_t initial_servo_writes = 0; // ウォームアップまでの書き込みは数えない
+    auto next_servo_update = StageStats::Clock::now(); // 書き込みは PWM 周期に1回まで (track の servo_loop と同じ)
+
+    LatencyHistogram frame_latency; // 検出 + 制御 (読み込みは含まない)
+    cv::Mat decoded, resized, frame(CAMERA_HEIGHT, CAMERA_WIDTH, gray ? CV_8UC1 : CV_8UC3);
+    MotionGate motion_gate;
+    cv::Rect last_face;
+    cv::Point last_nose(-1, -1);
+    long frames = 0, hits = 0, predictions = 0, skips = 0, reuses = 0, target_switches = 0, warmup = 0;
+    int last_target_id = 0;
+    StageStats::Clock::duration busy{};
+
+    while (max_frames <= 0 || frames < max_frames) {
+        auto read_start = StageStats::Clock::now();
+        if (!source.read(decoded)) break;
+        if (decoded.size() != frame.size()) {
+            cv::resize(decoded, resized, frame.size());
+        } else {
+            resized = decoded;
+        }
+        if (gray) {
+            cv::cvtColor(resized, frame, cv::COLOR_BGR2GRAY);
+        } else {
+            resized.copyTo(frame);
+        }
+        auto start = StageStats::Clock::now();
+
+        // track モードの find_nose() と同じ流れ
+        MotionGate::Action action = MotionGate::Action::Detect;
+        if (use_motion_gate) action = motion_gate.check(frame, detector.tracking(), last_face);
+        auto gated = StageStats::Clock::now();
+        FaceStatus status = FaceStatus::None;
+        cv::Point nose(-1, -1);
+        if (action == MotionGate::Action::Reuse) {
+            status = FaceStatus::Detected; // 前回の検出をそのまま使う
+            nose = last_nose;
+        } else if (action == MotionGate::Action::Detect) {
+            cv::Rect face;
+            status = detector.detect(frame, start, face); // 処理を始めた時刻をフレームの時刻とする
+            if (detector.target_id() != last_target_id) {
+                nose_locator.reset();
+                if (last_target_id != 0 && detector.target_id() != 0 && warmup >= WARMUP_FRAMES) ++target_switches;
+                last_target_id = detector.target_id();
+            }
+            if (status != FaceStatus::None) {
+                nose = nose_locator.locate(frame, face, status == FaceStatus::Detected);
+            } else {
+                nose_locator.reset();
+            }
+            last_face = status == FaceStatus::Detected ? face : cv::Rect();
+            last_nose = nose;
+        }
+        auto detected = StageStats::Clock::now();
+        pan_tilt.observe(nose, start);
+        pan_tilt.step(detected); // 実機では一定周期で動くが、ここでは1フレームにつき1回だけ回す
+        if (detected >= next_servo_update) { // 書き込みは PWM 周期 (20ms) に1回まで
+            servo_output.update(detected);
+            next_servo_update = detected + servo_output.params().period;
+        }
+        auto end = StageStats::Clock::now();
+
+        if (warmup < WARMUP_FRAMES) {
+            if (++warmup == WARMUP_FRAMES) { // ここから記録する
+                detector.set_stats(&stats);
+                nose_locator.set_stats(&stats);
+                initial_servo_writes = gpio->servo_writes();
+            }
+            continue;
+        }
+        stats.record(Stage::Capture, start - read_start);
+        if (use_motion_gate) stats.record(Stage::Motion, gated - start);
+        stats.record(Stage::Servo, end - detected);
+        stats.record(Stage::Pipeline, end - start);
+        frame_latency.record(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+        busy += end - start;
+        ++frames;
+        if (status == FaceStatus::Detected) ++hits;
+        if (status == FaceStatus::Predicted) ++predictions;
+        if (action == MotionGate::Action::Skip) ++skips;
+        if (action == MotionGate::Action::Reuse) ++reuses;
+    }
+
+    if (frames == 0) {
+        std::cerr << "ERROR: No frames were read from [" << source_path << "]\n";
+        return false;
+    }
+
+    // 読み込み時間を除いた処理だけの速さ
+    double busy_s = std::chrono::duration<double>(busy).count();
+    LatencyHistogram::Snapshot latency = frame_latency.take();
+    std::cout << "=== detector: " << engine << ", preprocess: " << preprocess << " ===\n";
+    stats.report(std::cout);
+    std::cout << std::fixed << std::setprecision(2)
+              << "RESULT detector=" << engine
+              << " frames=" << frames
+              << " fps=" << (busy_s > 0.0 ? frames / busy_s : 0.0)
+              << " p50_ms=" << latency.percentile(0.50) / 1000.0
+              << " p95_ms=" << latency.percentile(0.95) / 1000.0
+              << " p99_ms=" << latency.percentile(0.99) / 1000.0
+              << " max_ms=" << latency.max_us / 1000.0
+              << std::setprecision(3)
+              << " hit_rate=" << static_cast<double>(hits) / frames
+              << " predicted_rate=" << static_cast<double>(predictions) / frames
+              << " skip_rate=" << static_cast<double>(skips) / frames
+              << " reuse_rate=" << static_cast<double>(reuses) / frames
+              << " landmarks=" << (landmarks ? "yes" : "no")
+              << " detect_threads=" << detect_threads
+              << " preprocess=" << preprocess
+              << " lut_refreshes=" << detector.lut_refreshes()
+              << " target=" << target_policy
+              << " target_switches=" << target_switches
+              << " gray=" << (gray ? "yes" : "no")
+              << " motion_gate=" << (use_motion_gate ? "yes" : "no")
+              << " servo_writes=" << gpio->servo_writes() - initial_servo_writes << std::endl;
+    gpio->terminate();
+    return true;
+}
+
+}
+
+int run_bench(const Config& config, int argc, char** argv) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]).compare(0, 2, "--") != 0) positional.push_back(argv[i]);
+    }
+    if (positional.empty()) {
+        std::cerr << "usage: " << argv[0] << " bench <video file | image directory> [max frames] [--detector=NAME|all] [--detect-threads=N] [--target=POLICY] [--preprocess=fused|cached|opencv|all] [--gray] [--no-motion-gate]\n"
+                  << "  detectors: " << face_engine_names() << "\n";
+        return 1;
+    }
+    const std::string source_path = positional[0];
+    const long max_frames = positional.size() >= 2 ? std::atol(positional[1].c_str()) : 0; // 0 = 最後まで
+
+    // --detector=all なら使えるエンジンを順に同じ映像で測る (モデルが無いものは飛ばす)
+    const bool gray = has_arg(argc, argv, "--gray");
+    const bool use_motion_gate = !has_arg(argc, argv, "--no-motion-gate");
+    const FaceDetectorParams defaults = face_detector_params(config);
+    std::string engine = arg_value(argc, argv, "--detector=", defaults.engine);
+    int detect_threads = std::max(1, arg_value(argc, argv, "--detect-threads=", defaults.detect_threads));
+    std::string target_policy = arg_value(argc, argv, "--target=", defaults.tracker.policy);
+    if (!is_target_policy(target_policy)) {
+        std::cerr << "ERROR: Unknown target policy [" << target_policy << "] (available: sticky, largest, closest)\n";
+        return 1;
+    }
+    std::string preprocess = arg_value(argc, argv, "--preprocess=", defaults.preprocess);
+    if (preprocess != "all" && !is_preprocess_mode(preprocess)) {
+        std::cerr << "ERROR: Unknown preprocess mode [" << preprocess << "] (available: fused, cached, opencv, all)\n";
+        return 1;
+    }
+    std::vector<std::string> preprocess_modes;
+    if (preprocess == "all") {
+        preprocess_modes = {"opencv", "fused", "cached"};
+    } else {
+        preprocess_modes = {preprocess};
+    }
+
+    std::vector<std::string> engines;
+    if (engine != "all") {
+        engines.push_back(engine);
+    } else {
+        std::string names = face_engine_names();
+        for (size_t begin = 0; begin < names.size();) {
+            size_t end = names.find(", ", begin);
+            if (end == std::string::npos) end = names.size();
+            engines.push_back(names.substr(begin, end - begin));
+            begin = end + 2;
+        }
+    }
+
+    bool any = false, all = true;
+    for (const std::string& name : engines) {
+        for (const std::string& mode : preprocess_modes) {
+            bool ok = bench_engine(config, source_path, max_frames, name, detect_threads, target_policy, mode, gray, use_motion_gate);
+            any = any || ok;
+            all = all && ok;
+        }
+    }
+    return (engine == "all" ? any : all) ? 0 : 1;
+}
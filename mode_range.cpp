@@ -0,0 +1,139 @@
+// range-only モード: 超音波センサーと LED だけを動かし、0.5秒ごとに距離を表示する
+// (配線の確認と、校正表 calibration/ultrasonic.txt に書く echo の値を読むため)
+//
+// 使い方: ./ras_eye range-only [--config=PATH] [--gpio=pigpio|pigpiod|libgpiod|mock]
+
+#include <iostream>
+#include <atomic>   // 停止フラグ用
+#include <chrono> // 時間計測用
+#include <csignal>  // SIGINT/SIGTERM
+#include <thread>   // sleep用
+#include <iomanip>  // 距離表示の小数点制御用
+#include <memory>
+#include "gpio_device.hpp" // GPIO (pigpio など)
+#include "log.hpp"
+#include "modes.hpp"
+#include "settings.hpp"
+#include "ultrasonic.hpp"
+
+namespace {
+
+// --- グローバル定数 ---
+const auto DISPLAY_INTERVAL = std::chrono::milliseconds(500); // 距離を表示する間隔
+const int AIR_TEMPERATURE_LOOPS = 120;                         // このループ数 (1分) ごとに気温を読み直す
+
+// --- GPIO デバイス (起動時に --gpio=pigpio|pigpiod|libgpiod|mock で選ぶ。既定は pigpio) ---
+std::unique_ptr<GpioDevice> g_gpio;
+
+// --- 超音波センサー (バックグラウンドで測距し続ける) ---
+std::unique_ptr<UltrasonicRanger> g_ranger;
+
+// 警告用LED
+WarningParams g_warning;
+
+// 停止フラグ (SIGINT/SIGTERM で false になる)
+std::atomic<bool> g_running{true};
+
+// SIGINT/SIGTERM でループを抜けて終了処理をする (pigpio の場合は pigpio のシグナル処理から呼ばれる)
+void on_signal(int) {
+    g_running = false;
+}
+
+// --- 関数: 超音波センサーの最新の測定結果を読む ---
+// 測定自体はバックグラウンドで行われているので待たない
+// 直近の測定値の中央値 + EMA (フィルタした値) を返す。1回ごとの値は raw_cm と echo_us に入れる
+float get_distance_ultrasonic(float& raw_cm, uint32_t& echo_us) {
+    RangeReading reading = g_ranger->latest();
+    raw_cm = reading.valid() ? reading.distance_cm : -1.0f;
+    echo_us = reading.echo_us;
+    if (!reading.filtered) {
+        if (reading.status == RangeStatus::NoEcho) logger().debug("Echo low timeout.");
+        if (reading.status == RangeStatus::EchoStuck) logger().debug("Echo high timeout.");
+    }
+    return filtered_distance_cm(reading); // 測定失敗なら -1
+}
+
+// --- 関数: LEDを制御する (変わったときだけ表示する) ---
+void set_warning_led(bool on) {
+    static bool last = false;
+    g_gpio->write(g_warning.led_pin, on ? 1 : 0);
+    if (on != last) logger().info("LED State: {}", on ? "ON" : "OFF");
+    last = on;
+}
+
+}
+
+// --- range-only モード ---
+int run_range_only(const Config& config, int argc, char** argv) {
+    std::cout << "--- Ultrasonic Sensor & LED Test Program ---" << std::endl;
+    g_warning = warning_params(config);
+    g_ranger = std::make_unique<UltrasonicRanger>(ultrasonic_params(config));
+
+    // 1. pigpioの初期化
+    std::string device_name = arg_value(argc, argv, "--gpio=", config.get_string("gpio", "pigpio"));
+    g_gpio = make_gpio_device(device_name);
+    if (!g_gpio) {
+        std::cerr << "ERROR: Unknown GPIO device [" << device_name << "] (available: " << gpio_device_names() << ")\n";
+        return 1;
+    }
+    if (!g_gpio->initialise()) {
+        std::cerr << "ERROR: " << g_gpio->name() << " initialisation failed\n";
+        return 1;
+    }
+    std::cout << "DEBUG: " << g_gpio->name() << " initialized." << std::endl;
+
+    // 2. GPIOピンモード設定
+    g_gpio->set_mode(g_warning.led_pin, GpioMode::Output);
+    g_gpio->write(g_warning.led_pin, 0); // LEDをOffに初期化
+
+    // Trig/Echo の設定と測距の開始 (Trig は Low に初期化される)
+    if (!g_ranger->start(*g_gpio)) {
+        std::cerr << "ERROR: Could not start ultrasonic ranging\n";
+        g_gpio->terminate();
+        return 1;
+    }
+    std::cout << "DEBUG: GPIO pin modes set and initialized." << std::endl;
+
+    // Ctrl-C でも測距を止め、LED を消し、ログを書き出してから終わる
+    g_gpio->set_signal_func(SIGINT, on_signal);
+    g_gpio->set_signal_func(SIGTERM, on_signal);
+
+    // 音速は気温で補正する (校正表 calibration/ultrasonic.txt があればそれも使う)
+    std::string temperature_source;
+    g_ranger->set_air_temperature(read_air_temperature(g_ranger->params().calibration, temperature_source));
+    std::cout << "DEBUG: Air temperature " << std::fixed << std::setprecision(1) << g_ranger->air_temperature()
+              << " C (" << temperature_source << ")" << (g_ranger->calibrated() ? ", calibration table loaded" : "")
+              << ", echo timeout " << g_ranger->echo_timeout_ms() << " ms" << std::endl;
+
+    // 3. メインループ
+    ProximityAlarm alarm(g_warning.distance_cm, g_warning.hysteresis_cm);
+    for (int loop = 1; g_running; ++loop) {
+        if (loop % AIR_TEMPERATURE_LOOPS == 0) {
+            g_ranger->set_air_temperature(read_air_temperature(g_ranger->params().calibration, temperature_source));
+        }
+        float raw = 0.0f;
+        uint32_t echo_us = 0;
+        float distance = get_distance_ultrasonic(raw, echo_us);
+
+        // 表示は非同期のログに渡すだけ (echo は校正表に書く値)
+        if (distance > 0 && raw > 0) { // 距離が正常に測定できた場合
+            logger().info("Measured Distance: {.1} cm (raw {.1} cm, echo {} us, outliers: {})", distance, raw, echo_us,
+                          g_ranger->outliers());
+        } else if (distance > 0) { // この1回だけ測れなかった
+            logger().info("Measured Distance: {.1} cm (raw failed, outliers: {})", distance, g_ranger->outliers());
+        } else { // 測定失敗した場合
+            logger().info("Distance measurement failed.");
+        }
+        // 警告距離より近ければLED点灯、警告距離 + ヒステリシスより遠いか測定失敗なら消灯
+        set_warning_led(alarm.update(distance > 0, distance));
+
+        std::this_thread::sleep_for(DISPLAY_INTERVAL); // 0.5秒ごとに測定
+    }
+
+    // 4. 終了処理
+    g_ranger->stop();
+    set_warning_led(false);
+    g_gpio->terminate(); // GPIOの終了
+    std::cout << "Program terminated." << std::endl;
+    return 0;
+}
@@ -0,0 +1,678 @@
+// track モード: カメラで顔を追ってパン・チルトを動かし、超音波センサーで近すぎれば LED で警告する
+//
+// 使い方: ./ras_eye track [--config=PATH] [--gpio=pigpio|pigpiod|libgpiod|mock] [--detector=haar|lbp|yunet|ssd] [--detect-threads=N]
+//                         [--target=sticky|largest|closest] [--camera=opencv|v4l2] [--preprocess=fused|cached|opencv]
+// 引数は設定ファイル (gpio, detector, detect_threads, target, camera, preprocess) より優先する
+
+#include <iostream>
+#include <vector>
+#include <chrono>   // 時間計測用
+#include <thread>   // sleep用
+#include <cmath>    // abs用
+#include <iomanip>  // 距離表示の小数点制御用
+#include <sstream>  // 統計の表示をまとめる
+#include <atomic>   // スレッド間の停止フラグ用
+#include <mutex>    // キュー用
+#include <condition_variable>
+#include <optional>
+#include <array>
+#include <csignal>  // SIGINT/SIGTERM
+
+// --- OpenCV関連 ---
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+
+// --- Raspberry Pi GPIO制御関連 ---
+#include "gpio_device.hpp"
+#include "ultrasonic.hpp"
+
+#include "camera.hpp"
+#include "config.hpp"
+#include "face_detector.hpp"
+#include "frame_pool.hpp"
+#include "gray_preprocess.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+#include "modes.hpp"
+#include "motion_gate.hpp"
+#include "nose_locator.hpp"
+#include "pan_tilt.hpp"
+#include "preview.hpp"
+#include "rate_scheduler.hpp"
+#include "servo_output.hpp"
+#include "settings.hpp"
+#include "stage_stats.hpp"
+
+namespace {
+
+// --- グローバル定数と調整パラメータ ---
+// 配線・カメラの解像度・警告の距離は settings.hpp、各部の調整値は設定ファイル (ras_eye.conf) で変える
+
+// パイプライン設定
+const auto CONTROL_INTERVAL = std::chrono::milliseconds(10);   // サーボ制御の周期 (100Hz, 検出の速さとは独立)
+const auto QUEUE_POP_TIMEOUT = std::chrono::milliseconds(100); // キュー待ちのタイムアウト (停止フラグの確認間隔)
+const auto STATS_REPORT_INTERVAL = std::chrono::seconds(10); // 処理時間の統計を表示する間隔 (SIGUSR1 でもすぐ表示する)
+const auto AIR_TEMPERATURE_INTERVAL = std::chrono::seconds(60); // 音速の補正に使う気温を読み直す間隔
+
+// --- グローバル変数 (状態保持用) ---
+// GPIO デバイス (起動時に --gpio=pigpio|pigpiod|libgpiod|mock で選ぶ。既定は pigpio)
+std::unique_ptr<GpioDevice> g_gpio;
+
+// サーボへの出力段 (制御スレッドが目標を書き、サーボのスレッドが PWM 周期ごとに書き込む)
+// 軸ごとの端と動かす速さの上限は ServoOutputParams (servo_output.hpp) を参照
+std::unique_ptr<ServoOutput> g_servo_output;
+
+// パン・チルト制御 (目標の推定と制御の上でのサーボ角度を持つ。検出結果の受け渡しと制御周期は別スレッドでよい)
+// PID のゲイン・不感帯などの調整値は PanTiltParams (pan_tilt.hpp) を参照
+std::unique_ptr<PanTiltController> g_pan_tilt;
+
+// 処理段ごとの所要時間 (どのスレッドからも記録してよい)
+StageStats g_stage_stats;
+
+// OpenCV 顔検出器 (検出・追跡の状態と作業用バッファを持つ。検出スレッドだけが使う)
+std::unique_ptr<FaceDetector> g_face_detector;
+// 顔の枠の中の鼻の位置 (顔の切り出しだけを見る。検出スレッドだけが使う)
+NoseLocator g_nose_locator;
+// 動きの無いフレームでは顔検出を飛ばす・前回の結果を使う (検出スレッドだけが使う)
+MotionGate g_motion_gate;
+cv::Rect g_last_face;  // 前回検出した顔 (予測・見失いのときは空)
+cv::Point g_last_nose; // そのときの鼻の位置
+// 追跡の状態と SoC の温度で検出の頻度・カメラのフレームレートを決める (update() は検出スレッドだけが呼ぶ)
+RateScheduler g_rate_scheduler;
+
+// カメラ (起動時に --camera=opencv|v4l2 で選ぶ。既定は opencv)
+// フレームバッファはカメラが持ち回す (v4l2 ではドライバのバッファそのもの)
+std::unique_ptr<Camera> g_camera;
+
+// 超音波センサー (バックグラウンドで測距し続ける)
+std::unique_ptr<UltrasonicRanger> g_ranger;
+// 警告用LEDと警告の距離
+WarningParams g_warning;
+// 超音波で何かが近づいてきたら Idle の検出を起こす (ProximityWake, range_filter.hpp を参照)
+ProximityWakeParams g_proximity_wake;
+// 音速の補正に使っている気温をどこから読んだか ("ds18b20", "soc", "default"。メインスレッドだけが使う)
+std::string g_air_temperature_source;
+
+// 外から見るための数 (metrics の /metrics で出す。どれも atomic を足すだけ)
+std::atomic<uint64_t> g_frames_captured{0};
+std::array<std::atomic<uint64_t>, 3> g_detections{}; // FaceStatus (None, Detected, Predicted) ごとの回数
+std::atomic<uint64_t> g_range_invalid{0};            // フィルタした距離が無効だった (測れていない) 新しい測距結果の数
+CumulativeHistogram g_reacquire_time;                // 目標を見失ってから、また検出するまでの時間
+std::unique_ptr<MetricsServer> g_metrics;
+// ブラウザで見るためのプレビュー (検出スレッドが見ている人がいるときだけフレームを渡す)
+std::unique_ptr<PreviewServer> g_preview;
+
+// 全スレッド共通の停止フラグ (SIGINT/SIGTERM またはカメラ異常で false になる)
+std::atomic<bool> g_running{true};
+// SIGUSR1 で true になり、統計をすぐ表示する
+std::atomic<bool> g_report_requested{false};
+
+// --- パイプライン用の型 ---
+// キャプチャスレッド → 検出スレッドに渡すフレーム
+struct CapturedFrame {
+    FramePool::Handle frame;                        // g_camera から借りた画像 (BGR かグレースケール, ムーブのみ)
+    uint64_t seq = 0;                               // フレーム番号
+    std::chrono::steady_clock::time_point stamp;    // 取得時刻
+};
+
+// 検出スレッド → 制御スレッドに渡す検出結果
+struct DetectionResult {
+    cv::Point nose{-1, -1};                         // 検出できなかった場合は (-1, -1)
+    uint64_t frame_seq = 0;                         // 元になったフレーム番号
+    std::chrono::steady_clock::time_point stamp;    // 元フレームの取得時刻
+};
+
+// 容量1の単一生産者/単一消費者キュー
+// push() は未消費の要素があれば上書きするので、消費側は常に最新の要素だけを受け取る。
+// (処理が追いつかなくても古いフレームが溜まらない)
+template <typename T>
+class LatestQueue {
+public:
+    // 要素を入れる。未消費の古い要素を捨てた場合は true を返す
+    bool push(T item) {
+        bool overwritten;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            overwritten = m_slot.has_value();
+            if (overwritten) m_dropped.fetch_add(1, std::memory_order_relaxed);
+            m_slot = std::move(item);
+        }
+        m_cv.notify_one();
+        return overwritten;
+    }
+
+    // 要素が来るまで最大 timeout 待つ。取り出せたら true、タイムアウトか close() 済みなら false
+    template <typename Rep, typename Period>
+    bool pop(T& out, std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_cv.wait_for(lock, timeout, [this] { return m_slot.has_value() || m_closed; })) return false;
+        if (!m_slot.has_value()) return false; // close() された
+        out = std::move(*m_slot);
+        m_slot.reset();
+        return true;
+    }
+
+    // 待っている消費側を起こし、以降の pop() をすぐに返させる
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_cv.notify_all();
+    }
+
+    // 上書きで捨てた要素の数 (ロックを取らずに読める)
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::optional<T> m_slot;
+    bool m_closed = false;
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+// --- 関数宣言 (プロトタイプ) ---
+void setup_gpio(const std::string& device_name);
+void setup_opencv(const std::string& camera_backend, const Config& config);
+cv::Point find_nose(const CapturedFrame& captured);
+void control_pan_tilt(const DetectionResult& result);
+void set_warning_led(bool on);
+void capture_loop(LatestQueue<CapturedFrame>& frames);
+void detect_loop(LatestQueue<CapturedFrame>& frames, LatestQueue<DetectionResult>& detections);
+void actuate_loop(LatestQueue<DetectionResult>& detections);
+void control_loop();
+void servo_loop();
+void report_stats(LatestQueue<CapturedFrame>& frames);
+void update_air_temperature();
+void update_reacquire(FaceStatus status, std::chrono::steady_clock::time_point stamp);
+void collect_metrics(MetricsWriter& out, LatestQueue<CapturedFrame>& frames);
+void on_signal(int signum);
+
+// --- 関数定義 ---
+
+// GPIO初期設定 (Bさん, Cさん担当箇所)
+void setup_gpio(const std::string& device_name) {
+    g_gpio = make_gpio_device(device_name);
+    if (!g_gpio) {
+        std::cerr << "ERROR: Unknown GPIO device [" << device_name << "] (available: " << gpio_device_names() << ")\n";
+        exit(1);
+    }
+    if (!g_gpio->initialise()) {
+        std::cerr << "ERROR: " << g_gpio->name() << " initialisation failed\n";
+        exit(1);
+    }
+
+    g_servo_output->init(*g_gpio); // サーボを中央へ
+    g_pan_tilt->init(*g_servo_output);
+
+    // Trig/Echo は測距側で設定して、タイマーとエッジ検出を開始する (校正表があればここで読む)
+    if (!g_ranger->start(*g_gpio)) {
+        std::cerr << "ERROR: Could not start ultrasonic ranging\n";
+        g_gpio->terminate();
+        exit(1);
+    }
+    update_air_temperature();
+
+    g_gpio->set_mode(g_warning.led_pin, GpioMode::Output);
+    g_gpio->write(g_warning.led_pin, 0);
+}
+
+// OpenCV初期設定 (Aさん担当箇所)
+void setup_opencv(const std::string& camera_backend, const Config& config) {
+    if (!g_face_detector->load()) {
+        std::cerr << "ERROR: Could not load face detector " << g_face_detector->engine_description() << "\n";
+        g_gpio->terminate();
+        exit(1);
+    }
+    if (!g_nose_locator.load()) { // 無くても顔の中心を追えば動くので止めない
+        std::cerr << "WARNING: Could not load facemark model [" << g_nose_locator.params().model_path
+                  << "], tracking the face center instead\n";
+    }
+
+    CameraParams camera_params;
+    camera_params.backend = camera_backend;
+    camera_params.device = config.get_int("camera_device", 0); // 0は通常USBカメラまたはCSIカメラ
+    camera_params.size = cv::Size(CAMERA_WIDTH, CAMERA_HEIGHT);
+    g_camera = make_camera(camera_params);
+    if (!g_camera) {
+        std::cerr << "ERROR: Unknown camera backend [" << camera_backend << "] (available: opencv, v4l2)\n";
+        g_gpio->terminate();
+        exit(1);
+    }
+    if (!g_camera->open()) {
+        std::cerr << "ERROR: Could not open camera (" << g_camera->name() << ")\n";
+        g_gpio->terminate();
+        exit(1);
+    }
+}
+
+// 顔検出 (Aさん担当箇所)
+// 検出・追跡の中身は FaceDetector (face_detector.cpp) を参照
+// 鼻の位置は顔の枠の中だけで求める (NoseLocator, nose_locator.cpp を参照)
+// 追跡中に見失ったフレームでは、しばらく予測した位置を返す (その間もサーボは追い続ける)
+// 先にサムネイルの差分で動きを見て、動きが無ければ検出を飛ばす (MotionGate, motion_gate.cpp を参照)
+// 検出できなかった場合は x=-1, y=-1 を持つPointを返す
+cv::Point find_nose(const CapturedFrame& captured) {
+    static int last_target_id = 0;
+    const cv::Mat& image = captured.frame.image();
+    auto gate_start = StageStats::Clock::now();
+    MotionGate::Action action = g_motion_gate.check(image, g_face_detector->tracking(), g_last_face);
+    g_stage_stats.record(Stage::Motion, StageStats::Clock::now() - gate_start);
+    if (action == MotionGate::Action::Skip) return cv::Point(-1, -1); // 誰もいない静止した画面
+    if (action == MotionGate::Action::Reuse) return g_last_nose;      // 顔の周囲が止まっている
+
+    cv::Rect face;
+    float distance_cm = filtered_distance_cm(g_ranger->latest()); // 複数の顔から目標を選ぶとき (closest) に使う
+    g_face_detector->set_range_cm(distance_cm > 0 ? distance_cm : 0.0f);
+    FaceStatus status = g_face_detector->detect(image, captured.stamp, face);
+    g_detections[static_cast<int>(status)].fetch_add(1, std::memory_order_relaxed);
+    update_reacquire(status, captured.stamp);
+    if (g_face_detector->target_id() != last_target_id) { // 別の人に移った: 鼻の位置関係は前の人のもの
+        g_nose_locator.reset();
+        last_target_id = g_face_detector->target_id();
+    }
+    if (status == FaceStatus::None) {
+        g_nose_locator.reset();
+        g_last_face = cv::Rect();
+        return cv::Point(-1, -1); // 検出できなかった
+    }
+    cv::Point nose = g_nose_locator.locate(image, face, status == FaceStatus::Detected);
+    g_last_face = status == FaceStatus::Detected ? face : cv::Rect();
+    g_last_nose = nose;
+    return nose;
+}
+
+// パン・チルト制御 (あなた担当箇所)
+// 検出結果を目標として渡すだけ。サーボの目標は control_loop() が一定周期で動かし、servo_loop() が書き込む
+// 制御の中身は PanTiltController (pan_tilt.cpp) を参照
+void control_pan_tilt(const DetectionResult& result) {
+    g_pan_tilt->observe(result.nose, result.stamp);
+}
+
+// 警告LEDの制御 (Cさん担当箇所)
+void set_warning_led(bool on) {
+    g_gpio->write(g_warning.led_pin, on ? 1 : 0); // 同じ状態なら実際には書き込まれない
+}
+
+// --- パイプラインの各スレッド ---
+
+// キャプチャスレッド: カメラのフレームレートで取得し続け、最新フレームだけを検出スレッドに渡す
+// 画像はカメラが持ち回すバッファに直接入るので、毎フレームの確保もコピーも起きない
+void capture_loop(LatestQueue<CapturedFrame>& frames) {
+    uint64_t seq = 0;
+    int camera_fps = g_rate_scheduler.params().active_fps;
+    while (g_running) {
+        // Idle の間はカメラ自体を遅くする (変えられないカメラではそのまま)
+        if (g_rate_scheduler.camera_fps() != camera_fps) {
+            camera_fps = g_rate_scheduler.camera_fps();
+            g_camera->set_frame_rate(camera_fps);
+        }
+
+        CapturedFrame captured;
+        bool ok;
+        {
+            ScopedStageTimer timer(&g_stage_stats, Stage::Capture);
+            ok = g_camera->read(captured.frame, captured.stamp);
+        }
+        if (!ok) {
+            logger().error("Failed to capture frame. Exiting.");
+            g_running = false;
+            break;
+        }
+        captured.seq = seq++;
+        g_frames_captured.fetch_add(1, std::memory_order_relaxed);
+        frames.push(std::move(captured)); // 未消費の古いフレームはここでカメラに返る
+    }
+    frames.close();
+}
+
+// 検出スレッド: 最新フレームだけを顔検出し、結果を制御スレッドに渡す
+void detect_loop(LatestQueue<CapturedFrame>& frames, LatestQueue<DetectionResult>& detections) {
+    CapturedFrame captured;
+    while (g_running) {
+        if (!frames.pop(captured, QUEUE_POP_TIMEOUT)) continue;
+        auto start = std::chrono::steady_clock::now();
+
+        DetectionResult result;
+        result.nose = find_nose(captured);
+        result.frame_seq = captured.seq;
+        result.stamp = captured.stamp;
+        detections.push(result);
+        // プレビュー (見ている人がいなければ atomic を1つ読むだけ。縮小・符号化はプレビューのスレッドで行う)
+        if (g_preview->wants_frame(start)) {
+            PreviewOverlay overlay;
+            overlay.face = g_last_face;
+            overlay.nose = result.nose;
+            overlay.target_id = g_face_detector->tracking() ? g_face_detector->target_id() : 0;
+            overlay.distance_cm = filtered_distance_cm(g_ranger->latest());
+            overlay.rate_state = rate_state_name(g_rate_scheduler.state());
+            g_preview->offer(captured.frame.image(), overlay, start);
+        }
+        captured = CapturedFrame(); // 待つ間にフレームバッファを抱えないよう先に返す
+
+        // 状態に応じた間隔まで休む (Locked なら検出の速さいっぱいで、ほとんど休まない)
+        auto now = std::chrono::steady_clock::now();
+        g_rate_scheduler.update(g_face_detector->tracking(), g_motion_gate.last_action() != MotionGate::Action::Skip,
+                                now - start, now);
+        // (Idle の間も、超音波で何かが近づいてくればすぐ起きる)
+        g_rate_scheduler.sleep_until(start + g_rate_scheduler.interval());
+    }
+    detections.close();
+}
+
+// 結果・センサースレッド: 検出結果が来るたびに制御の目標を更新し、新しい測距結果が出るたびにLEDを更新する
+// 何かが近づいてきたら、Idle で休んでいる検出を起こす
+// (距離は毎回は表示せず、report_stats() でまとめて表示する)
+void actuate_loop(LatestQueue<DetectionResult>& detections) {
+    uint32_t last_reading_seq = 0;
+    ProximityAlarm alarm(g_warning.distance_cm, g_warning.hysteresis_cm);
+    ProximityWake wake(g_proximity_wake);
+    DetectionResult result;
+    while (g_running) {
+        // 検出結果を待つ (来なければタイムアウトしてLEDの更新だけ行う)
+        if (detections.pop(result, QUEUE_POP_TIMEOUT)) {
+            control_pan_tilt(result);
+            g_stage_stats.record(Stage::Pipeline, std::chrono::steady_clock::now() - result.stamp);
+        }
+
+        // 超音波センサーの最新結果 (測距はバックグラウンドなので待たない)
+        RangeReading reading = g_ranger->latest();
+        if (reading.seq == last_reading_seq) continue; // 新しい結果がまだ無い
+        last_reading_seq = reading.seq;
+        float distance_cm = filtered_distance_cm(reading); // 測れていなければ -1
+        if (distance_cm <= 0) g_range_invalid.fetch_add(1, std::memory_order_relaxed);
+
+        // LEDによるフィードバック (しきい値より近ければ点灯、しきい値 + ヒステリシスより遠いか測れなければ消灯)
+        set_warning_led(alarm.update(distance_cm > 0, distance_cm));
+        if (wake.update(distance_cm > 0, distance_cm)) g_rate_scheduler.wake();
+    }
+}
+
+// サーボ制御スレッド: CONTROL_INTERVAL ごとに目標を外挿してサーボの目標を動かす
+// (検出を待たないので、検出が遅くても動きが途切れない。サーボが落ち着くのを待つ必要もない)
+void control_loop() {
+    auto next = std::chrono::steady_clock::now();
+    while (g_running) {
+        next += CONTROL_INTERVAL;
+        {
+            ScopedStageTimer timer(&g_stage_stats, Stage::Servo);
+            g_pan_tilt->step(std::chrono::steady_clock::now());
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now > next + CONTROL_INTERVAL) next = now; // 大きく遅れたら周期を取り直す (まとめて追いつこうとしない)
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// サーボのスレッド: PWM 周期ごとに、制御が書いた目標へ向けてサーボを動かす
+// (pigpiod ではサーボの書き込みがソケット越しになるので、制御の周期を乱さないよう別スレッドにしている)
+void servo_loop() {
+    const auto period = g_servo_output->params().period;
+    auto next = std::chrono::steady_clock::now();
+    while (g_running) {
+        next += period;
+        g_servo_output->update(std::chrono::steady_clock::now());
+        auto now = std::chrono::steady_clock::now();
+        if (now > next + period) next = now; // 大きく遅れたら周期を取り直す
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// 処理段ごとの統計と最新の距離をまとめて表示する
+// ログのスレッドも std::cout に書くので、全部を組み立ててから1回の write() で出す (行の途中に割り込まれない)
+void report_stats(LatestQueue<CapturedFrame>& frames) {
+    std::ostringstream out;
+    g_stage_stats.report(out);
+
+    float distance_cm = filtered_distance_cm(g_ranger->latest());
+    if (distance_cm > 0) {
+        out << "Distance: " << std::fixed << std::setprecision(1) << distance_cm << " cm";
+    } else {
+        out << "Distance: Out of range / Error";
+    }
+    out << " (outliers rejected: " << g_ranger->outliers() << ", air " << std::setprecision(1)
+        << g_ranger->air_temperature() << " C from " << g_air_temperature_source
+        << (g_ranger->calibrated() ? ", calibrated" : "") << ", echo timeout " << g_ranger->echo_timeout_ms()
+        << " ms, cycle " << g_ranger->cycle_ms() << " ms)";
+    out << ", tracking: ";
+    if (g_face_detector->tracking()) {
+        out << "id " << g_face_detector->target_id() << " (" << g_face_detector->track_count() << " faces)";
+    } else {
+        out << "no";
+    }
+    out << ", rate: " << rate_state_name(g_rate_scheduler.state()) << " (camera " << g_rate_scheduler.camera_fps() << " fps";
+    if (!std::isnan(g_rate_scheduler.temperature())) {
+        out << ", SoC " << std::setprecision(1) << g_rate_scheduler.temperature() << " C, backoff x"
+            << std::setprecision(2) << g_rate_scheduler.backoff();
+    }
+    out << ")"
+        << ", dropped frames (total): " << frames.dropped()
+        << ", detections skipped / reused (total): " << g_motion_gate.skipped() << " / " << g_motion_gate.reused()
+        << ", range-gated scans / proximity wakes (total): " << g_face_detector->range_gated_scans() << " / "
+        << g_rate_scheduler.wakes()
+        << ", servo updates (total): " << g_servo_output->writes() << " written / " << g_servo_output->skipped() << " unchanged"
+        << ", gpio writes (total): " << g_gpio->writes_issued() << " issued / " << g_gpio->writes_skipped() << " skipped"
+        << ", log messages dropped / suppressed (total): " << logger().dropped() << " / " << logger().suppressed()
+        << "\n";
+    const std::string text = out.str();
+    std::cout.write(text.data(), static_cast<std::streamsize>(text.size())).flush();
+}
+
+// 気温を読んで測距の音速を補正する (DS18B20 は読むのに 1 秒近くかかるのでメインスレッドから呼ぶ)
+void update_air_temperature() {
+    g_ranger->set_air_temperature(read_air_temperature(g_ranger->params().calibration, g_air_temperature_source));
+}
+
+// 目標を見失ったフレームの時刻を覚えておき、次に検出したときにそこまでの時間を記録する (検出スレッドから呼ぶ)
+void update_reacquire(FaceStatus status, std::chrono::steady_clock::time_point stamp) {
+    static bool lost = false;
+    static std::chrono::steady_clock::time_point lost_at;
+    if (status == FaceStatus::Detected) {
+        if (lost) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(stamp - lost_at).count();
+            g_reacquire_time.record(static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(us, 0), UINT32_MAX)));
+            lost = false;
+        }
+    } else if (!lost && !g_last_face.empty()) { // 直前までは検出できていた
+        lost = true;
+        lost_at = stamp;
+    }
+}
+
+// /metrics の中身 (metrics のサーバーのスレッドから呼ばれる。atomic を読むだけで、どのスレッドも待たせない)
+void collect_metrics(MetricsWriter& out, LatestQueue<CapturedFrame>& frames) {
+    out.describe("ras_eye_frames_captured_total", "counter", "Frames read from the camera");
+    out.sample("ras_eye_frames_captured_total", "", g_frames_captured.load());
+    out.describe("ras_eye_frames_dropped_total", "counter", "Frames overwritten before the detector took them");
+    out.sample("ras_eye_frames_dropped_total", "", frames.dropped());
+
+    out.describe("ras_eye_detections_total", "counter", "Face detector results by outcome (predicted and none are misses)");
+    out.sample("ras_eye_detections_total", "result=\"detected\"", g_detections[static_cast<int>(FaceStatus::Detected)].load());
+    out.sample("ras_eye_detections_total", "result=\"predicted\"", g_detections[static_cast<int>(FaceStatus::Predicted)].load());
+    out.sample("ras_eye_detections_total", "result=\"none\"", g_detections[static_cast<int>(FaceStatus::None)].load());
+    out.describe("ras_eye_motion_gate_total", "counter", "Frames where detection was skipped or reused because nothing moved");
+    out.sample("ras_eye_motion_gate_total", "action=\"skip\"", g_motion_gate.skipped());
+    out.sample("ras_eye_motion_gate_total", "action=\"reuse\"", g_motion_gate.reused());
+    out.describe("ras_eye_range_gated_scans_total", "counter", "Full-frame scans limited to the face size expected from the distance");
+    out.sample("ras_eye_range_gated_scans_total", "", g_face_detector->range_gated_scans());
+    out.describe("ras_eye_proximity_wakes_total", "counter", "Times an approaching object woke detection from idle");
+    out.sample("ras_eye_proximity_wakes_total", "", g_rate_scheduler.wakes());
+    out.describe("ras_eye_reacquire_seconds", "histogram", "Time from losing the target to detecting a face again");
+    out.histogram("ras_eye_reacquire_seconds", "", g_reacquire_time.snapshot());
+
+    out.describe("ras_eye_tracking", "gauge", "1 while the detector is locked on a target");
+    out.sample("ras_eye_tracking", "", g_face_detector->tracking() ? 1.0 : 0.0);
+    out.describe("ras_eye_tracked_faces", "gauge", "Faces currently tracked");
+    out.sample("ras_eye_tracked_faces", "", static_cast<double>(g_face_detector->track_count()));
+    out.describe("ras_eye_target_id", "gauge", "Track id of the current target (0 when not tracking)");
+    out.sample("ras_eye_target_id", "", static_cast<double>(g_face_detector->tracking() ? g_face_detector->target_id() : 0));
+    out.describe("ras_eye_rate_state", "gauge", "Detection rate state (1 for the current state)");
+    for (RateScheduler::State state : {RateScheduler::State::Locked, RateScheduler::State::Searching, RateScheduler::State::Idle}) {
+        out.sample("ras_eye_rate_state", std::string("state=\"") + rate_state_name(state) + "\"",
+                   g_rate_scheduler.state() == state ? 1.0 : 0.0);
+    }
+    out.describe("ras_eye_camera_fps", "gauge", "Requested camera frame rate");
+    out.sample("ras_eye_camera_fps", "", static_cast<double>(g_rate_scheduler.camera_fps()));
+    if (!std::isnan(g_rate_scheduler.temperature())) {
+        out.describe("ras_eye_soc_temperature_celsius", "gauge", "SoC temperature");
+        out.sample("ras_eye_soc_temperature_celsius", "", static_cast<double>(g_rate_scheduler.temperature()));
+        out.describe("ras_eye_thermal_backoff", "gauge", "Detection interval multiplier from thermal backoff");
+        out.sample("ras_eye_thermal_backoff", "", static_cast<double>(g_rate_scheduler.backoff()));
+    }
+
+    out.describe("ras_eye_stage_seconds", "histogram", "Time spent in each processing stage");
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        Stage stage = static_cast<Stage>(i);
+        out.histogram("ras_eye_stage_seconds", std::string("stage=\"") + stage_name(stage) + "\"", g_stage_stats.cumulative(stage));
+    }
+
+    out.describe("ras_eye_range_results_total", "counter", "Ultrasonic ranging results by status");
+    for (int i = static_cast<int>(RangeStatus::Ok); i < static_cast<int>(RangeStatus::Count); ++i) {
+        RangeStatus status = static_cast<RangeStatus>(i);
+        out.sample("ras_eye_range_results_total", std::string("status=\"") + range_status_name(status) + "\"",
+                   g_ranger->results(status));
+    }
+    out.describe("ras_eye_range_invalid_total", "counter", "New ranging results where the filtered distance was invalid");
+    out.sample("ras_eye_range_invalid_total", "", g_range_invalid.load());
+    out.describe("ras_eye_range_outliers_total", "counter", "Ranging samples rejected by the filter");
+    out.sample("ras_eye_range_outliers_total", "", g_ranger->outliers());
+    float distance_cm = filtered_distance_cm(g_ranger->latest());
+    out.describe("ras_eye_distance_cm", "gauge", "Filtered ultrasonic distance (-1 when invalid)");
+    out.sample("ras_eye_distance_cm", "", static_cast<double>(distance_cm));
+    out.describe("ras_eye_air_temperature_celsius", "gauge", "Air temperature used for the speed of sound");
+    out.sample("ras_eye_air_temperature_celsius", "", static_cast<double>(g_ranger->air_temperature()));
+
+    out.describe("ras_eye_servo_updates_total", "counter", "Servo output updates by outcome");
+    out.sample("ras_eye_servo_updates_total", "result=\"written\"", g_servo_output->writes());
+    out.sample("ras_eye_servo_updates_total", "result=\"unchanged\"", g_servo_output->skipped());
+    out.describe("ras_eye_gpio_writes_total", "counter", "GPIO writes by outcome");
+    out.sample("ras_eye_gpio_writes_total", "result=\"issued\"", g_gpio->writes_issued());
+    out.sample("ras_eye_gpio_writes_total", "result=\"skipped\"", g_gpio->writes_skipped());
+
+    out.describe("ras_eye_log_messages_total", "counter", "Log messages not written");
+    out.sample("ras_eye_log_messages_total", "result=\"dropped\"", logger().dropped());
+    out.sample("ras_eye_log_messages_total", "result=\"suppressed\"", logger().suppressed());
+    out.describe("ras_eye_preview_clients", "gauge", "Browsers watching the preview stream");
+    out.sample("ras_eye_preview_clients", "", static_cast<double>(g_preview->clients()));
+    out.describe("ras_eye_preview_frames_total", "counter", "Preview frames sent");
+    out.sample("ras_eye_preview_frames_total", "", g_preview->frames_sent());
+    out.describe("ras_eye_metrics_scrapes_total", "counter", "Requests served on /metrics");
+    out.sample("ras_eye_metrics_scrapes_total", "", g_metrics->scrapes());
+}
+
+// SIGINT/SIGTERM で全スレッドを止め、SIGUSR1 で統計を表示させる (pigpio の場合は pigpio のシグナル処理から呼ばれる)
+void on_signal(int signum) {
+    if (signum == SIGUSR1) {
+        g_report_requested = true;
+        return;
+    }
+    g_running = false;
+}
+
+}
+
+// --- track モード (すべての機能を呼び出す中心) ---
+int run_track(const Config& config, int argc, char** argv) {
+    // 1. 全体の初期設定 (設定ファイルの値で作り、引数があればそちらを使う)
+    g_warning = warning_params(config);
+    g_proximity_wake = proximity_wake_params(config);
+    g_servo_output = std::make_unique<ServoOutput>(servo_output_params(config));
+    g_pan_tilt = std::make_unique<PanTiltController>(pan_tilt_params(config));
+    g_face_detector = std::make_unique<FaceDetector>(face_detector_params(config));
+    g_ranger = std::make_unique<UltrasonicRanger>(ultrasonic_params(config));
+    g_face_detector->set_engine(arg_value(argc, argv, "--detector=", g_face_detector->params().engine));
+    // Pi 4 (4コア) なら 2〜3。キャプチャ・制御・測距のスレッドの分は残す
+    g_face_detector->set_detect_threads(std::max(1, arg_value(argc, argv, "--detect-threads=", g_face_detector->params().detect_threads)));
+    std::string target_policy = arg_value(argc, argv, "--target=", g_face_detector->params().tracker.policy);
+    if (!is_target_policy(target_policy)) {
+        std::cerr << "ERROR: Unknown target policy [" << target_policy << "] (available: sticky, largest, closest)\n";
+        return 1;
+    }
+    g_face_detector->set_target_policy(target_policy);
+    std::string preprocess = arg_value(argc, argv, "--preprocess=", g_face_detector->params().preprocess);
+    if (!is_preprocess_mode(preprocess)) {
+        std::cerr << "ERROR: Unknown preprocess mode [" << preprocess << "] (available: fused, cached, opencv)\n";
+        return 1;
+    }
+    g_face_detector->set_preprocess(preprocess);
+    g_face_detector->set_stats(&g_stage_stats);
+    g_nose_locator.set_stats(&g_stage_stats);
+    g_ranger->set_stats(&g_stage_stats);
+    setup_gpio(arg_value(argc, argv, "--gpio=", config.get_string("gpio", "pigpio")));
+    setup_opencv(arg_value(argc, argv, "--camera=", config.get_string("camera", "opencv")), config);
+    g_gpio->set_signal_func(SIGINT, on_signal);
+    g_gpio->set_signal_func(SIGTERM, on_signal);
+    g_gpio->set_signal_func(SIGUSR1, on_signal);
+
+    // 追跡の様子はブラウザで見る (preview_port が 0 なら無効, preview.hpp を参照)
+    g_preview = std::make_unique<PreviewServer>(preview_params(config));
+    if (!g_preview->start(g_camera->size())) {
+        g_camera->close();
+        g_gpio->terminate();
+        return 1;
+    }
+    if (g_preview->running()) {
+        std::cout << "Preview: http://" << g_preview->params().address << ":" << g_preview->params().port << "/ ("
+                  << g_preview->encoder_name() << " JPEG encoder)" << std::endl;
+    }
+
+    // 2. パイプライン開始
+    // キャプチャ → (最新フレーム) → 検出 → (最新結果) → 目標の更新・測距
+    // サーボ制御はそれとは別に一定周期で動き、サーボへの書き込みはさらに別のスレッドが PWM 周期ごとに行う
+    // 検出の頻度は追跡の状態と SoC の温度で変わる (RateScheduler, rate_scheduler.cpp を参照)
+    LatestQueue<CapturedFrame> frames;
+    LatestQueue<DetectionResult> detections;
+
+    // 外から状態を見るための /metrics (metrics_port が 0 なら無効, metrics.hpp を参照)
+    g_metrics = std::make_unique<MetricsServer>(metrics_params(config));
+    if (!g_metrics->start([&frames](MetricsWriter& out) { collect_metrics(out, frames); })) {
+        g_preview->stop();
+        g_camera->close();
+        g_gpio->terminate();
+        return 1;
+    }
+    if (g_metrics->running()) {
+        std::cout << "Metrics: http://" << g_metrics->params().address << ":" << g_metrics->params().port << "/metrics" << std::endl;
+    }
+
+    std::thread capture_thread(capture_loop, std::ref(frames));
+    std::thread detect_thread(detect_loop, std::ref(frames), std::ref(detections));
+    std::thread actuate_thread(actuate_loop, std::ref(detections));
+    std::thread control_thread(control_loop);
+    std::thread servo_thread(servo_loop);
+
+    // メインスレッドは統計の表示だけを行う
+    auto next_report = std::chrono::steady_clock::now() + STATS_REPORT_INTERVAL;
+    auto next_air_temperature = std::chrono::steady_clock::now() + AIR_TEMPERATURE_INTERVAL;
+    while (g_running) {
+        std::this_thread::sleep_for(QUEUE_POP_TIMEOUT);
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_air_temperature) {
+            update_air_temperature();
+            next_air_temperature = now + AIR_TEMPERATURE_INTERVAL;
+        }
+        if (g_report_requested.exchange(false) || now >= next_report) {
+            report_stats(frames);
+            next_report = now + STATS_REPORT_INTERVAL;
+        }
+    }
+
+    capture_thread.join();
+    frames.close();
+    detect_thread.join();
+    detections.close();
+    actuate_thread.join();
+    control_thread.join();
+    servo_thread.join();
+    g_metrics->stop();
+    g_preview->stop();
+
+    // 3. 終了処理
+    g_ranger->stop();
+    set_warning_led(false);
+    g_camera->close();
+    g_gpio->terminate(); // GPIOの終了
+    return 0;
+}
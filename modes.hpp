@@ -0,0 +1,14 @@
+#pragma once
+// ras_eye の動作モード (ras_eye.cpp の main() が1つ選んで呼ぶ)
+//
+// どのモードも同じ設定ファイル (config) を読み、コマンドライン引数 (--detector= など) はその値を上書きする。
+// 戻り値は main() の終了コード。
+
+#include "config.hpp"
+
+// 顔を追ってパン・チルトを動かし、近すぎれば LED で警告する (mode_track.cpp)
+int run_track(const Config& config, int argc, char** argv);
+// 超音波センサーと LED だけを動かし、距離を表示する (配線の確認・校正表を作るとき用, mode_range.cpp)
+int run_range_only(const Config& config, int argc, char** argv);
+// 録画した映像で顔検出とパン・チルト制御の速さを測る (GPIO はダミー, mode_bench.cpp)
+int run_bench(const Config& config, int argc, char** argv);
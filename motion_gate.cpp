@@ -0,0 +1,70 @@
+#include "motion_gate.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+#include "face_detector.hpp" // expand_rect
+
+MotionGate::MotionGate(const MotionGateParams& params) : m_params(params) {}
+
+MotionGate::Action MotionGate::check(const cv::Mat& frame, bool tracking, const cv::Rect& last_face) {
+    m_last_action = decide(frame, tracking, last_face);
+    return m_last_action;
+}
+
+MotionGate::Action MotionGate::decide(const cv::Mat& frame, bool tracking, const cv::Rect& last_face) {
+    // 先に縮小してからグレースケールにする (変換する画素が少なくて済む)
+    if (frame.channels() == 3) {
+        cv::resize(frame, m_small, m_params.thumbnail_size, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(m_small, m_thumbnail, cv::COLOR_BGR2GRAY);
+    } else {
+        cv::resize(frame, m_thumbnail, m_params.thumbnail_size, 0, 0, cv::INTER_AREA);
+    }
+
+    bool first = !m_has_previous;
+    if (!first) {
+        cv::absdiff(m_thumbnail, m_previous, m_diff);
+        cv::threshold(m_diff, m_mask, m_params.pixel_threshold, 255, cv::THRESH_BINARY);
+    }
+    std::swap(m_thumbnail, m_previous); // 次の差分の基準 (バッファは入れ替えるだけ)
+    m_has_previous = true;
+    if (first) return Action::Detect;
+
+    if (!tracking) {
+        m_reuse_frames = 0;
+        cv::Rect whole(0, 0, m_mask.cols, m_mask.rows);
+        if (moved_fraction(whole) < m_params.scene_fraction && ++m_idle_frames < m_params.idle_refresh) {
+            ++m_skipped;
+            return Action::Skip;
+        }
+        m_idle_frames = 0;
+        return Action::Detect;
+    }
+
+    // 顔の周囲 (フレーム座標) をサムネイル座標に直して見る
+    m_idle_frames = 0;
+    if (last_face.area() <= 0) { // 前回は予測だった: 使い回せる結果が無い
+        m_reuse_frames = 0;
+        return Action::Detect;
+    }
+    float scale_x = static_cast<float>(m_mask.cols) / frame.cols;
+    float scale_y = static_cast<float>(m_mask.rows) / frame.rows;
+    cv::Rect area = expand_rect(last_face, m_params.region_margin, frame.size());
+    cv::Rect region(static_cast<int>(area.x * scale_x), static_cast<int>(area.y * scale_y),
+                    std::max(1, static_cast<int>(area.width * scale_x)), std::max(1, static_cast<int>(area.height * scale_y)));
+    region &= cv::Rect(0, 0, m_mask.cols, m_mask.rows);
+    if (region.area() > 0 && moved_fraction(region) < m_params.region_fraction
+        && ++m_reuse_frames < m_params.reuse_refresh) {
+        ++m_reused;
+        return Action::Reuse;
+    }
+    m_reuse_frames = 0;
+    return Action::Detect;
+}
+
+float MotionGate::moved_fraction(const cv::Rect& rect) const {
+    if (rect.area() <= 0) return 0.0f;
+    return static_cast<float>(cv::countNonZero(m_mask(rect))) / rect.area();
+}
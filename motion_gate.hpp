@@ -0,0 +1,70 @@
+#pragma once
+// 動き検出による顔検出の間引き
+//
+// フレームを小さなサムネイル (グレースケール) に縮小し、前のフレームとの差分で動きを見る。
+// - 何も追跡していなくて画面に動きが無ければ、顔検出を飛ばす (Skip)
+// - 追跡中で顔の周囲に動きが無ければ、前回の結果を使い回す (Reuse)
+// 静止した顔を見逃し続けないよう、idle_refresh / reuse_refresh フレームごとには必ず検出させる。
+// カメラ (サーボ) が動いている間は画面全体が動くので、自然に毎フレーム検出になる。
+// 1つのスレッドからだけ使うこと。
+
+#include <atomic>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+// 動き検出パラメータ (要調整)
+struct MotionGateParams {
+    cv::Size thumbnail_size{80, 60}; // 差分を取るサムネイルの大きさ
+    int pixel_threshold = 12;        // 明るさがこれより変わった画素を「動いた」とみなす (0-255)
+    float scene_fraction = 0.005f;   // 画面全体でこの割合以上の画素が動いたら動きありとする
+    float region_fraction = 0.03f;   // 顔の周囲でこの割合以上の画素が動いたら動きありとする
+    float region_margin = 0.25f;     // 顔の周囲として見る範囲: 顔の枠を顔サイズ×この割合だけ広げる
+    int idle_refresh = 30;           // 動きが無くても、このフレーム数ごとに1回は検出する
+    int reuse_refresh = 10;          // 使い回しは続けてこのフレーム数まで
+};
+
+class MotionGate {
+public:
+    // check() の結果
+    enum class Action {
+        Detect, // 検出する
+        Skip,   // 何も追跡しておらず動きも無い: 検出せずに「顔なし」とする
+        Reuse,  // 追跡中の顔の周囲に動きが無い: 前回の結果を使う
+    };
+
+    explicit MotionGate(const MotionGateParams& params = MotionGateParams());
+
+    // フレーム (BGR かグレースケール) を取り込み、検出するかどうかを決める
+    // tracking は追跡中か、last_face は前回検出した顔 (フレーム座標, 追跡中のときだけ使う)
+    // 前回が検出ではなかった (予測や使い回しできない結果) なら last_face は空の Rect にする
+    Action check(const cv::Mat& frame, bool tracking, const cv::Rect& last_face);
+
+    // 飛ばした・使い回したフレームの数 (他のスレッドから読んでよい)
+    uint64_t skipped() const { return m_skipped; }
+    uint64_t reused() const { return m_reused; }
+    // 最後の check() の結果
+    Action last_action() const { return m_last_action; }
+
+    const MotionGateParams& params() const { return m_params; }
+
+private:
+    Action decide(const cv::Mat& frame, bool tracking, const cv::Rect& last_face);
+    // m_mask の rect (サムネイル座標) の中で動いた画素の割合
+    float moved_fraction(const cv::Rect& rect) const;
+
+    MotionGateParams m_params;
+    bool m_has_previous = false;
+    Action m_last_action = Action::Detect;
+    int m_idle_frames = 0;   // 続けて Skip したフレーム数
+    int m_reuse_frames = 0;  // 続けて Reuse したフレーム数
+    std::atomic<uint64_t> m_skipped{0};
+    std::atomic<uint64_t> m_reused{0};
+
+    // 作業領域 (使い回す)
+    cv::Mat m_small;     // 縮小したフレーム (BGR のときだけ使う)
+    cv::Mat m_thumbnail; // 今のサムネイル
+    cv::Mat m_previous;  // 前のサムネイル
+    cv::Mat m_diff;
+    cv::Mat m_mask;      // 動いた画素が 255
+};
@@ -0,0 +1,108 @@
+#include "nose_locator.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_FACE
+#include <opencv2/face.hpp>
+#endif
+
+#include "face_detector.hpp" // expand_rect
+
+namespace {
+
+const size_t NOSE_TIP = 30; // 68点モデルの鼻先
+
+}
+
+struct NoseLocator::Model {
+#ifdef HAVE_OPENCV_FACE
+    cv::Ptr<cv::face::Facemark> facemark;
+#endif
+};
+
+NoseLocator::NoseLocator(const NoseLocatorParams& params)
+    : m_params(params), m_nose_ratio(params.default_nose) {}
+
+NoseLocator::~NoseLocator() = default;
+
+bool NoseLocator::load() {
+#ifdef HAVE_OPENCV_FACE
+    std::unique_ptr<Model> model(new Model());
+    try {
+        model->facemark = cv::face::createFacemarkLBF();
+        model->facemark->loadModel(m_params.model_path);
+    } catch (const cv::Exception&) {
+        return false;
+    }
+    m_model = std::move(model);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NoseLocator::loaded() const {
+    return m_model != nullptr;
+}
+
+cv::Point NoseLocator::locate(const cv::Mat& frame, const cv::Rect& face, bool detected) {
+    // fit_interval フレームに1回だけ (見つけ直した直後はすぐに) 特徴点を求める
+    if (detected && m_model && (m_frames_since_fit < 0 || m_frames_since_fit + 1 >= m_params.fit_interval)) {
+        cv::Point2f nose;
+        if (fit(frame, face, nose)) {
+            m_nose_ratio = cv::Point2f((nose.x - face.x) / face.width, (nose.y - face.y) / face.height);
+            m_frames_since_fit = 0;
+        }
+    } else if (m_frames_since_fit >= 0) {
+        ++m_frames_since_fit;
+    }
+    // 間のフレームでは、顔の枠に対する鼻の位置は変わらないとみなす
+    return cv::Point(face.x + static_cast<int>(m_nose_ratio.x * face.width),
+                     face.y + static_cast<int>(m_nose_ratio.y * face.height));
+}
+
+void NoseLocator::reset() {
+    m_nose_ratio = m_params.default_nose;
+    m_frames_since_fit = -1;
+}
+
+// 顔の周囲だけを切り出して縮小し、その中で特徴点を求める。鼻先 (フレーム座標) が求まれば true
+bool NoseLocator::fit(const cv::Mat& frame, const cv::Rect& face, cv::Point2f& nose) {
+#ifdef HAVE_OPENCV_FACE
+    ScopedStageTimer timer(m_stats, Stage::Landmark);
+    cv::Rect area = expand_rect(face, m_params.crop_margin, frame.size());
+    if (area.width <= 0 || area.height <= 0) return false;
+
+    // 長い辺が crop_size になるように縮小する (縦横比は変えない)
+    float scale = static_cast<float>(m_params.crop_size) / std::max(area.width, area.height);
+    cv::Size crop_size(std::max(1, static_cast<int>(area.width * scale)), std::max(1, static_cast<int>(area.height * scale)));
+    cv::resize(frame(area), m_crop, crop_size, 0, 0, cv::INTER_AREA);
+    if (m_crop.channels() == 3) {
+        cv::cvtColor(m_crop, m_crop_gray, cv::COLOR_BGR2GRAY);
+    } else {
+        m_crop_gray = m_crop; // カメラがグレースケールで出している
+    }
+
+    m_crop_faces.assign(1, cv::Rect(static_cast<int>((face.x - area.x) * scale), static_cast<int>((face.y - area.y) * scale),
+                                    static_cast<int>(face.width * scale), static_cast<int>(face.height * scale)));
+    m_landmarks.clear();
+    try {
+        if (!m_model->facemark->fit(m_crop_gray, m_crop_faces, m_landmarks)) return false;
+    } catch (const cv::Exception&) {
+        return false;
+    }
+    if (m_landmarks.empty() || m_landmarks[0].size() <= NOSE_TIP) return false;
+
+    // 切り出しの座標 → フレーム座標
+    const cv::Point2f& tip = m_landmarks[0][NOSE_TIP];
+    nose = cv::Point2f(area.x + tip.x / scale, area.y + tip.y / scale);
+    return true;
+#else
+    (void)frame;
+    (void)face;
+    (void)nose;
+    return false;
+#endif
+}
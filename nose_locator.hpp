@@ -0,0 +1,69 @@
+#pragma once
+// 鼻の位置の推定 (Aさん担当箇所)
+//
+// 顔検出の枠の中から鼻先を探す。フレーム全体は見ずに、顔の枠の周囲を (長い辺が crop_size になるように) 縮小した
+// 切り出しだけで特徴点 (cv::face::FacemarkLBF, 68点) を求めるので、処理時間はフレームサイズに関係なく一定。
+// 特徴点を求めるのは fit_interval フレームに1回だけで、その間のフレームでは前回求めた
+// 「顔の枠の中での鼻の位置 (枠に対する割合)」を今の枠に当てはめる。
+// モデルが無い (opencv_contrib の face モジュールが無い) ときは顔の枠の中心を返す。
+// 1つのスレッドからだけ使うこと。
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "stage_stats.hpp"
+
+// 鼻の位置の推定パラメータ (要調整)
+struct NoseLocatorParams {
+    std::string model_path = "models/lbfmodel.yaml"; // FacemarkLBF の学習済みモデル
+    int crop_size = 128;       // 特徴点を求める切り出しの大きさ (px, 正方形)
+    float crop_margin = 0.1f;  // 切り出す範囲: 顔の枠の周囲に顔サイズ×この割合だけ広げる
+    int fit_interval = 3;      // 特徴点を求める間隔 (フレーム数, 1 なら毎フレーム)
+    cv::Point2f default_nose{0.5f, 0.5f}; // 特徴点をまだ求めていないときの鼻の位置 (顔の枠に対する割合)
+};
+
+class NoseLocator {
+public:
+    explicit NoseLocator(const NoseLocatorParams& params = NoseLocatorParams());
+    ~NoseLocator();
+
+    NoseLocator(const NoseLocator&) = delete;
+    NoseLocator& operator=(const NoseLocator&) = delete;
+
+    // 特徴点のモデルを読み込む。失敗したら false (その後も顔の枠の中心を返して動く)
+    bool load();
+    bool loaded() const;
+
+    // フレーム (BGR かグレースケール) の face (フレーム座標) の中の鼻先 (フレーム座標) を返す
+    // detected が false (予測した顔の枠) のときは特徴点を求めず、前回の位置関係を当てはめるだけ
+    cv::Point locate(const cv::Mat& frame, const cv::Rect& face, bool detected);
+
+    // 顔を見失ったら呼ぶ (次に見つけた顔ではすぐに特徴点を求める)
+    void reset();
+
+    // 特徴点を求めた時間を stats に記録する (nullptr で記録しない)
+    void set_stats(StageStats* stats) { m_stats = stats; }
+
+    const NoseLocatorParams& params() const { return m_params; }
+
+private:
+    bool fit(const cv::Mat& frame, const cv::Rect& face, cv::Point2f& nose);
+
+    struct Model; // FacemarkLBF (face モジュールがあるときだけ中身がある)
+
+    NoseLocatorParams m_params;
+    std::unique_ptr<Model> m_model;
+    StageStats* m_stats = nullptr;
+
+    cv::Point2f m_nose_ratio;     // 顔の枠に対する鼻の位置 (0〜1)
+    int m_frames_since_fit = -1;  // 前回特徴点を求めてからのフレーム数 (-1 = まだ求めていない)
+
+    // 作業領域 (使い回す)
+    cv::Mat m_crop;
+    cv::Mat m_crop_gray;
+    std::vector<cv::Rect> m_crop_faces;
+    std::vector<std::vector<cv::Point2f>> m_landmarks;
+};
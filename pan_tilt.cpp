@@ -0,0 +1,135 @@
+#include "pan_tilt.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 制御スレッドが止まっていた場合に1周期で大きく動きすぎないよう、dt はここで打ち切る
+const double MAX_STEP_DT = 0.05;
+
+double seconds(PanTiltController::Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+float clamp_abs(float value, float limit) {
+    return std::min(std::max(value, -limit), limit);
+}
+
+}
+
+PanTiltController::PanTiltController(const PanTiltParams& params) : m_params(params) {
+    m_pan.pulse = m_pan_limits.center_pulse;
+    m_tilt.pulse = m_tilt_limits.center_pulse;
+}
+
+void PanTiltController::init(ServoOutput& output) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_output = &output;
+    m_pan_limits = output.params().pan;
+    m_tilt_limits = output.params().tilt;
+    m_pan.pulse = output.pan_pulse();
+    m_tilt.pulse = output.tilt_pulse();
+}
+
+void PanTiltController::observe(cv::Point nose, Clock::time_point stamp) {
+    if (nose.x == -1 || nose.y == -1) return; // 鼻が検出されていない
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_has_target && stamp <= m_target_stamp) return; // 古いフレームの結果
+
+    // そのフレームを撮ったときのサーボ角度に、画面上のずれを足したものが目標角度
+    PulseSample at = pulses_at(stamp);
+    float pan_target = at.pan - m_params.pulse_per_pixel_pan * (nose.x - m_params.frame_center.x); // 符号は要調整 (カメラとサーボの向きによる)
+    float tilt_target = at.tilt + m_params.pulse_per_pixel_tilt * (nose.y - m_params.frame_center.y); // 符号は要調整
+
+    // 前の検出から間が空きすぎていなければ、差分から目標の速さを推定する
+    double dt = 0.0;
+    if (m_has_target && stamp - m_target_stamp <= m_params.max_velocity_gap) dt = seconds(stamp - m_target_stamp);
+    observe_axis(m_pan, m_pan_limits.clamp(pan_target), dt);
+    observe_axis(m_tilt, m_tilt_limits.clamp(tilt_target), dt);
+    m_has_target = true;
+    m_target_stamp = stamp;
+}
+
+bool PanTiltController::step(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double dt = m_last_step == Clock::time_point() ? 0.0 : std::min(seconds(now - m_last_step), MAX_STEP_DT);
+    m_last_step = now;
+
+    // 見失ってから max_extrapolation を過ぎたら止まる (ahead < 0)
+    double ahead = -1.0;
+    if (m_has_target && now - m_target_stamp <= m_params.max_extrapolation) {
+        ahead = std::max(0.0, seconds(now - m_target_stamp));
+    }
+    bool pan_moved = step_axis(m_pan, m_pan_limits, ahead, dt, m_params.dead_zone * m_params.pulse_per_pixel_pan);
+    bool tilt_moved = step_axis(m_tilt, m_tilt_limits, ahead, dt, m_params.dead_zone * m_params.pulse_per_pixel_tilt);
+
+    // 書き込みは ServoOutput が PWM 周期ごとにまとめて行う (ここでは待たない)
+    if (m_output && (pan_moved || tilt_moved)) m_output->command(m_pan.pulse, m_tilt.pulse);
+
+    // 速さの制限で遅れることがあるので、記録するのは実際に出ている角度
+    float pan = m_output ? m_output->pan_pulse() : m_pan.pulse;
+    float tilt = m_output ? m_output->tilt_pulse() : m_tilt.pulse;
+    m_history[m_history_next] = {now, pan, tilt};
+    m_history_next = (m_history_next + 1) % HISTORY_SIZE;
+    if (m_history_count < HISTORY_SIZE) ++m_history_count;
+    return pan_moved || tilt_moved;
+}
+
+float PanTiltController::pan_pulse() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pan.pulse;
+}
+
+float PanTiltController::tilt_pulse() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tilt.pulse;
+}
+
+void PanTiltController::observe_axis(Axis& axis, float target, double dt) const {
+    if (dt > 0.0) {
+        float measured = static_cast<float>((target - axis.target) / dt);
+        float smoothed = m_params.velocity_smoothing * measured + (1.0f - m_params.velocity_smoothing) * axis.target_velocity;
+        axis.target_velocity = clamp_abs(smoothed, m_params.max_target_velocity);
+    } else {
+        axis.target_velocity = 0.0f; // 初回・間が空いたときは止まっているとみなす
+    }
+    axis.target = target;
+}
+
+bool PanTiltController::step_axis(Axis& axis, const ServoAxisParams& limits, double ahead, double dt,
+                                  float dead_zone) const {
+    float predicted = ahead >= 0.0 ? limits.clamp(axis.target + axis.target_velocity * static_cast<float>(ahead)) : axis.pulse;
+    float error = predicted - axis.pulse;
+    if (ahead < 0.0 || dt <= 0.0 || std::abs(error) <= dead_zone) {
+        axis.integral = 0.0f;
+        axis.velocity = 0.0f;
+        return false;
+    }
+
+    axis.integral = clamp_abs(axis.integral + error * static_cast<float>(dt), m_params.max_integral);
+    // 目標の速さで先回りし (フィードフォワード)、残りの差を PID で詰める
+    float velocity = axis.target_velocity
+                   + m_params.kp * error
+                   + m_params.ki * axis.integral
+                   + m_params.kd * (axis.target_velocity - axis.velocity);
+    velocity = clamp_abs(velocity, m_params.max_speed);
+
+    float next = limits.clamp(axis.pulse + velocity * static_cast<float>(dt));
+    axis.velocity = static_cast<float>((next - axis.pulse) / dt);
+    bool moved = next != axis.pulse;
+    axis.pulse = next;
+    return moved;
+}
+
+// stamp 以前で最も新しい記録 (記録が無ければ現在の角度, どれも新しすぎれば最も古い記録)
+PanTiltController::PulseSample PanTiltController::pulses_at(Clock::time_point stamp) const {
+    if (m_history_count == 0) return {stamp, m_pan.pulse, m_tilt.pulse};
+    size_t index = m_history_next;
+    for (size_t i = 0; i < m_history_count; ++i) {
+        index = (index + HISTORY_SIZE - 1) % HISTORY_SIZE;
+        if (m_history[index].time <= stamp) return m_history[index];
+    }
+    return m_history[index];
+}
@@ -0,0 +1,98 @@
+#pragma once
+// パン・チルト制御 (あなた担当箇所)
+//
+// 検出結果 (鼻の位置) から目標のサーボ角度と目標の動く速さを推定し、一定周期の step() で
+// PID 制御 + 速度フィードフォワードで追いかける。検出と検出の間も目標の動きを外挿するので、
+// 検出が制御より遅くてもなめらかに動く。
+// - 画面上のずれは、そのフレームを撮ったときのサーボ角度を基準にした目標角度に直す
+//   (カメラ自身が動いた分は目標の速度に混ざらない)
+// - 目標との差が dead_zone ピクセル以内なら動かさない
+// - 最後の検出から max_extrapolation を過ぎたら (見失ったら) 現在位置で止まる
+// サーボへの書き込みは ServoOutput (servo_output.hpp) が PWM 周期ごとに行う。step() は目標を渡すだけ。
+// 軸ごとの端 (パルス幅の範囲) と起動時の角度も ServoOutput の設定を使う。
+// ServoOutput::init() の後で init() を呼ぶこと。observe() と step() は別のスレッドから呼んでよい。
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+#include "servo_output.hpp"
+
+// サーボ制御パラメータ (要調整)
+struct PanTiltParams {
+    cv::Point frame_center{320, 240}; // 画面中心 (CAMERA_WIDTH / 2, CAMERA_HEIGHT / 2)
+    float pulse_per_pixel_pan = 1.0f;  // 画面上の1ピクセルに相当するパルス幅 (us)。カメラの画角とサーボで決まる
+    float pulse_per_pixel_tilt = 1.0f;
+    float kp = 8.0f;           // 比例ゲイン (1/s): 目標との差 1us あたり毎秒何 us 動かすか
+    float ki = 1.0f;           // 積分ゲイン (1/s^2)
+    float kd = 0.1f;           // 微分ゲイン: 目標とサーボの速度差にかける
+    float max_integral = 100.0f;       // 積分項の上限 (us*s, 積分の溜まりすぎ防止)
+    float max_speed = 3000.0f;         // サーボを動かす速さの上限 (us/s)
+    float velocity_smoothing = 0.5f;   // 目標速度の推定の平滑化 (1: 最新の差分だけ, 小さいほどなめらか)
+    float max_target_velocity = 2000.0f; // 推定する目標速度の上限 (us/s, 誤検出で飛ばないように)
+    std::chrono::milliseconds max_extrapolation{300}; // 最後の検出からこの時間を過ぎたら外挿をやめて止まる
+    std::chrono::milliseconds max_velocity_gap{500};  // 検出の間隔がこれより空いたら速度を推定し直す
+    int dead_zone = 15;        // 目標との差が±dead_zoneピクセル以内なら動かさない
+};
+
+class PanTiltController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PanTiltController(const PanTiltParams& params = PanTiltParams());
+
+    // output の起動時の角度から始める (以降の step() は output に目標を渡す)
+    void init(ServoOutput& output);
+
+    // 検出結果を渡す。stamp はそのフレームを撮った時刻
+    // nose.x == -1 (見失った) のときは何もしない (max_extrapolation までは前の目標の外挿を続ける)
+    void observe(cv::Point nose, Clock::time_point stamp);
+
+    // 制御1周期分: 目標を now まで外挿して、PID でサーボの目標を動かす。動かしたら true
+    bool step(Clock::time_point now);
+
+    // 制御の上でのサーボ角度 (PWM値。実際に出ている値は ServoOutput::pan_pulse())
+    float pan_pulse() const;
+    float tilt_pulse() const;
+
+    const PanTiltParams& params() const { return m_params; }
+
+private:
+    // 1軸分の目標と制御の状態
+    struct Axis {
+        float pulse;                 // 現在のサーボ角度
+        float target = 0.0f;         // 最後の検出から求めた目標角度
+        float target_velocity = 0.0f; // 目標の速さ (us/s)
+        float integral = 0.0f;       // 目標との差の積分 (us*s)
+        float velocity = 0.0f;       // 前の周期にサーボを動かした速さ (us/s)
+    };
+
+    // step() ごとの実際に出ているサーボ角度の記録 (フレームを撮ったときの角度を引くため)
+    struct PulseSample {
+        Clock::time_point time;
+        float pan;
+        float tilt;
+    };
+    static const size_t HISTORY_SIZE = 64; // 100Hz で 640ms 分
+
+    void observe_axis(Axis& axis, float target, double dt) const;
+    bool step_axis(Axis& axis, const ServoAxisParams& limits, double ahead, double dt, float dead_zone) const;
+    PulseSample pulses_at(Clock::time_point stamp) const;
+
+    PanTiltParams m_params;
+    ServoOutput* m_output = nullptr;
+    ServoAxisParams m_pan_limits;  // 軸ごとの端 (init() で ServoOutput から写す)
+    ServoAxisParams m_tilt_limits;
+
+    mutable std::mutex m_mutex; // 以下は observe() と step() で共有する
+    Axis m_pan;
+    Axis m_tilt;
+    bool m_has_target = false;
+    Clock::time_point m_target_stamp; // 最後の検出のフレーム時刻
+    Clock::time_point m_last_step;
+    std::array<PulseSample, HISTORY_SIZE> m_history;
+    size_t m_history_count = 0;
+    size_t m_history_next = 0;
+};
@@ -0,0 +1,63 @@
+#!/bin/sh
+# PGO (profile-guided optimization) ビルド
+#
+# 1. build-pgo/ に計測用の ras_eye をビルドし (RAS_EYE_PGO=generate)、録画を bench モードで流してプロファイルを取る
+# 2. 同じ build-pgo/ をプロファイルを使う設定 (RAS_EYE_PGO=use, LTO も) で構成し直してビルドする
+# 3. 普通のビルド (build/) と PGO のビルドで同じ bench を流し、fps の差を表示する
+# 検出・前処理・制御 (track モードと同じコード) は bench が通るので、その部分がプロファイルで最適化される。
+# プロファイルは録画の内容で変わるので、実際に置く場所で撮った録画 (人が映っている時間・いない時間の両方) を使う。
+#
+# 使い方: ./pgo_build.sh <録画.mp4 | 画像フォルダ> [bench の引数...]
+#   例: ./pgo_build.sh 録画.mp4 --detector=lbp --detect-threads=3
+#   bench の引数を省くと --detector=all --preprocess=all (使えるものを全部通す)
+#   cmake への引数は RAS_EYE_CMAKE_ARGS で渡す (例: RAS_EYE_CMAKE_ARGS="-DRAS_EYE_CPU=pi4 -DRAS_EYE_WITH_PIGPIOD=ON")
+#   できあがりは build-pgo/ras_eye (build/ras_eye は比べるための普通のビルド)
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <video file | image directory> [bench options...]" >&2
+    exit 1
+fi
+FOOTAGE=$1
+shift
+if [ $# -eq 0 ]; then
+    set -- --detector=all --preprocess=all
+fi
+JOBS=$(nproc 2>/dev/null || echo 4)
+SOURCE_DIR=$(cd "$(dirname "$0")" && pwd)
+PROFILE_DIR="$SOURCE_DIR/build-pgo/pgo-profile"
+
+# RESULT の行から「detector / preprocess / fps」を取り出す
+results() {
+    sed -n 's/^RESULT detector=\([^ ]*\) frames=[^ ]* fps=\([^ ]*\) .* preprocess=\([^ ]*\) .*/\1 \3 \2/p'
+}
+
+echo "=== normal build (build/) ==="
+cmake -S "$SOURCE_DIR" -B "$SOURCE_DIR/build" -DCMAKE_BUILD_TYPE=Release -DRAS_EYE_PGO=off $RAS_EYE_CMAKE_ARGS
+cmake --build "$SOURCE_DIR/build" -j"$JOBS"
+
+echo "=== instrumented build (build-pgo/, RAS_EYE_PGO=generate) ==="
+rm -rf "$PROFILE_DIR" # 古いプロファイルが混ざらないように
+cmake -S "$SOURCE_DIR" -B "$SOURCE_DIR/build-pgo" -DCMAKE_BUILD_TYPE=Release -DRAS_EYE_PGO=generate \
+      -DRAS_EYE_PGO_DIR="$PROFILE_DIR" $RAS_EYE_CMAKE_ARGS
+cmake --build "$SOURCE_DIR/build-pgo" -j"$JOBS"
+
+echo "=== training: ras_eye bench $FOOTAGE $* ==="
+"$SOURCE_DIR/build-pgo/ras_eye" bench "$FOOTAGE" "$@" > /dev/null
+
+echo "=== optimized build (build-pgo/, RAS_EYE_PGO=use) ==="
+cmake -S "$SOURCE_DIR" -B "$SOURCE_DIR/build-pgo" -DRAS_EYE_PGO=use
+cmake --build "$SOURCE_DIR/build-pgo" -j"$JOBS"
+
+echo "=== comparing ==="
+NORMAL=$(mktemp)
+PGO=$(mktemp)
+trap 'rm -f "$NORMAL" "$PGO"' EXIT
+"$SOURCE_DIR/build/ras_eye" bench "$FOOTAGE" "$@" | results > "$NORMAL"
+"$SOURCE_DIR/build-pgo/ras_eye" bench "$FOOTAGE" "$@" | results > "$PGO"
+# 同じ引数で流すので、RESULT の行は同じ順に並ぶ
+paste -d ' ' "$NORMAL" "$PGO" | awk '{
+    delta = $3 > 0 ? ($6 - $3) / $3 * 100 : 0
+    printf "PGO detector=%s preprocess=%s normal_fps=%.2f pgo_fps=%.2f delta=%+.1f%%\n", $1, $2, $3, $6, delta
+}'
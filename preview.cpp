@@ -0,0 +1,440 @@
+#include "preview.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <linux/videodev2.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "http_util.hpp"
+
+namespace {
+
+const int ACCEPT_POLL_MS = 200;   // 停止フラグを確かめる間隔
+const int ENCODE_TIMEOUT_MS = 1000; // ハードウェアのエンコーダーがこの時間返さなければ失敗とする
+const char* BOUNDARY = "ras_eye_frame";
+
+// OpenCV の imencode (libjpeg-turbo, どの機種でも動く)
+class OpenCvJpegEncoder : public JpegEncoder {
+public:
+    explicit OpenCvJpegEncoder(int quality) : m_options{cv::IMWRITE_JPEG_QUALITY, quality} {}
+
+    const char* name() const override { return "opencv"; }
+    bool open(const cv::Size&) override { return true; }
+
+    bool encode(const cv::Mat& bgr, std::vector<uint8_t>& out) override {
+        return cv::imencode(".jpg", bgr, out, m_options);
+    }
+
+private:
+    std::vector<int> m_options;
+};
+
+// V4L2 の memory-to-memory の JPEG エンコーダー (Raspberry Pi 4 以前の bcm2835-codec)
+// YUV420 (I420) を OUTPUT キューに入れ、CAPTURE キューから JPEG を受け取る。バッファは各1枚を使い回す
+class V4l2JpegEncoder : public JpegEncoder {
+public:
+    V4l2JpegEncoder(const std::string& device, int quality) : m_device(device), m_quality(quality) {}
+    ~V4l2JpegEncoder() override { close(); }
+
+    const char* name() const override { return "v4l2"; }
+
+    bool open(const cv::Size& size) override {
+        m_size = size;
+        m_fd = ::open(m_device.c_str(), O_RDWR | O_NONBLOCK);
+        if (m_fd < 0) return false; // 無い機種では何も言わずに opencv にする
+
+        v4l2_capability cap{};
+        if (xioctl(VIDIOC_QUERYCAP, &cap) < 0) return fail("VIDIOC_QUERYCAP");
+        uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+        if (!(caps & V4L2_CAP_VIDEO_M2M_MPLANE) || !(caps & V4L2_CAP_STREAMING)) {
+            std::cerr << "WARNING: preview: " << m_device << " is not a memory-to-memory encoder\n";
+            return false;
+        }
+        if (!set_format(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_PIX_FMT_YUV420, m_in_stride, m_in_size)) {
+            return fail("VIDIOC_S_FMT (YUV420 input)");
+        }
+        uint32_t out_stride = 0, out_size = 0;
+        if (!set_format(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, V4L2_PIX_FMT_JPEG, out_stride, out_size)) {
+            return fail("VIDIOC_S_FMT (JPEG output)");
+        }
+        // 縦は 16 の倍数に揃えられることがあるので、Y 面の行数はバッファの大きさから求める
+        m_in_rows = m_in_stride ? m_in_size * 2 / (3 * m_in_stride) : 0;
+        if (m_in_stride < static_cast<uint32_t>(m_size.width) || m_in_rows < static_cast<uint32_t>(m_size.height)) {
+            return fail("unexpected YUV420 layout");
+        }
+
+        v4l2_control control{};
+        control.id = V4L2_CID_JPEG_COMPRESSION_QUALITY;
+        control.value = m_quality;
+        xioctl(VIDIOC_S_CTRL, &control); // 画質を変えられないドライバもあるので失敗は無視する
+
+        if (!map_buffer(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, m_input) || !map_buffer(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, m_output)) {
+            return fail("buffer setup");
+        }
+        for (v4l2_buf_type type : {V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE}) {
+            if (xioctl(VIDIOC_STREAMON, &type) < 0) return fail("VIDIOC_STREAMON");
+        }
+        m_streaming = true;
+        return true;
+    }
+
+    bool encode(const cv::Mat& bgr, std::vector<uint8_t>& out) override {
+        cv::cvtColor(bgr, m_i420, cv::COLOR_BGR2YUV_I420);
+        copy_i420(static_cast<uint8_t*>(m_input.start));
+
+        if (!queue(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, m_in_size) || !queue(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, 0)) return false;
+        uint32_t bytes = 0;
+        bool ok = dequeue(V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, POLLIN, &bytes);
+        ok = dequeue(V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, POLLOUT, nullptr) && ok; // 入力のバッファも必ず取り戻す
+        if (!ok || bytes == 0) return false;
+        const uint8_t* jpeg = static_cast<const uint8_t*>(m_output.start);
+        out.assign(jpeg, jpeg + std::min<size_t>(bytes, m_output.length));
+        return true;
+    }
+
+    void close() {
+        if (m_fd < 0) return;
+        if (m_streaming) {
+            for (v4l2_buf_type type : {V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE}) {
+                xioctl(VIDIOC_STREAMOFF, &type);
+            }
+            m_streaming = false;
+        }
+        for (Buffer* buffer : {&m_input, &m_output}) {
+            if (buffer->start) munmap(buffer->start, buffer->length);
+            *buffer = Buffer();
+        }
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+private:
+    struct Buffer {
+        void* start = nullptr;
+        size_t length = 0;
+    };
+
+    int xioctl(unsigned long request, void* arg) {
+        int result;
+        do {
+            result = ioctl(m_fd, request, arg);
+        } while (result < 0 && errno == EINTR);
+        return result;
+    }
+
+    bool fail(const char* what) {
+        std::cerr << "WARNING: preview: " << m_device << ": " << what << " failed: " << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+
+    bool set_format(v4l2_buf_type type, uint32_t format, uint32_t& stride, uint32_t& size) {
+        v4l2_format fmt{};
+        fmt.type = type;
+        fmt.fmt.pix_mp.width = static_cast<uint32_t>(m_size.width);
+        fmt.fmt.pix_mp.height = static_cast<uint32_t>(m_size.height);
+        fmt.fmt.pix_mp.pixelformat = format;
+        fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+        fmt.fmt.pix_mp.num_planes = 1;
+        if (xioctl(VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix_mp.pixelformat != format) return false;
+        if (fmt.fmt.pix_mp.width != static_cast<uint32_t>(m_size.width) || fmt.fmt.pix_mp.height != static_cast<uint32_t>(m_size.height)) {
+            errno = EINVAL; // エンコーダーが大きさを変えた (この大きさは扱えない)
+            return false;
+        }
+        stride = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+        size = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+        return true;
+    }
+
+    bool map_buffer(v4l2_buf_type type, Buffer& buffer) {
+        v4l2_requestbuffers req{};
+        req.count = 1;
+        req.type = type;
+        req.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_REQBUFS, &req) < 0 || req.count < 1) return false;
+
+        v4l2_plane plane{};
+        v4l2_buffer buf{};
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = 0;
+        buf.length = 1;
+        buf.m.planes = &plane;
+        if (xioctl(VIDIOC_QUERYBUF, &buf) < 0) return false;
+        void* start = mmap(nullptr, plane.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, plane.m.mem_offset);
+        if (start == MAP_FAILED) return false;
+        buffer.start = start;
+        buffer.length = plane.length;
+        return true;
+    }
+
+    bool queue(v4l2_buf_type type, uint32_t bytes_used) {
+        v4l2_plane plane{};
+        plane.bytesused = bytes_used;
+        v4l2_buffer buf{};
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = 0;
+        buf.length = 1;
+        buf.m.planes = &plane;
+        return xioctl(VIDIOC_QBUF, &buf) == 0;
+    }
+
+    bool dequeue(v4l2_buf_type type, short events, uint32_t* bytes_used) {
+        v4l2_plane plane{};
+        v4l2_buffer buf{};
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.length = 1;
+        buf.m.planes = &plane;
+        while (true) {
+            if (xioctl(VIDIOC_DQBUF, &buf) == 0) break;
+            if (errno != EAGAIN) return false;
+            pollfd pfd{m_fd, events, 0};
+            if (poll(&pfd, 1, ENCODE_TIMEOUT_MS) <= 0) return false;
+        }
+        if (bytes_used) *bytes_used = (buf.flags & V4L2_BUF_FLAG_ERROR) ? 0 : plane.bytesused;
+        return true;
+    }
+
+    // OpenCV の I420 (詰めて並ぶ) を、ドライバの行の幅・行数のバッファに並べ直す
+    void copy_i420(uint8_t* dst) const {
+        const int width = m_size.width, height = m_size.height;
+        const uint8_t* src = m_i420.ptr<uint8_t>();
+        for (int y = 0; y < height; ++y) std::memcpy(dst + y * m_in_stride, src + y * width, width);
+        src += width * height;
+        uint8_t* chroma = dst + m_in_stride * m_in_rows;
+        const uint32_t chroma_stride = m_in_stride / 2, chroma_rows = m_in_rows / 2;
+        for (int plane = 0; plane < 2; ++plane) { // U, V
+            for (int y = 0; y < height / 2; ++y) std::memcpy(chroma + y * chroma_stride, src + y * (width / 2), width / 2);
+            src += (width / 2) * (height / 2);
+            chroma += chroma_stride * chroma_rows;
+        }
+    }
+
+    std::string m_device;
+    int m_quality;
+    cv::Size m_size;
+    int m_fd = -1;
+    bool m_streaming = false;
+    uint32_t m_in_stride = 0; // Y 面の1行のバイト数
+    uint32_t m_in_size = 0;   // 入力のバッファ全体
+    uint32_t m_in_rows = 0;   // Y 面の行数 (揃えた後)
+    Buffer m_input, m_output;
+    cv::Mat m_i420;
+};
+
+}
+
+// --- JpegEncoder ---
+
+std::unique_ptr<JpegEncoder> make_jpeg_encoder(const PreviewParams& params, const cv::Size& size) {
+    std::unique_ptr<JpegEncoder> encoder;
+    if (params.encoder == "v4l2" || params.encoder == "auto") {
+        encoder.reset(new V4l2JpegEncoder(params.encoder_device, params.jpeg_quality));
+        if (encoder->open(size)) return encoder;
+        if (params.encoder == "v4l2") return nullptr;
+    }
+    if (params.encoder == "opencv" || params.encoder == "auto") {
+        encoder.reset(new OpenCvJpegEncoder(params.jpeg_quality));
+        if (encoder->open(size)) return encoder;
+    }
+    return nullptr;
+}
+
+// --- PreviewServer ---
+
+PreviewServer::PreviewServer(const PreviewParams& params) : m_params(params) {}
+
+PreviewServer::~PreviewServer() {
+    stop();
+}
+
+bool PreviewServer::start(const cv::Size& frame_size) {
+    if (m_params.port <= 0 || running()) return true;
+
+    // 縦横比を保って縮める (エンコーダーのために幅・高さは偶数にする)
+    m_frame_size = frame_size;
+    int width = std::min(m_params.width, frame_size.width) & ~1;
+    int height = (width * frame_size.height / std::max(1, frame_size.width)) & ~1;
+    m_preview_size = cv::Size(width, height);
+    m_encoder = make_jpeg_encoder(m_params, m_preview_size);
+    if (!m_encoder) {
+        std::cerr << "ERROR: preview: could not open JPEG encoder [" << m_params.encoder << "] (available: auto, v4l2, opencv)\n";
+        return false;
+    }
+
+    m_socket = http_listen("preview", m_params.address, m_params.port);
+    if (m_socket < 0) {
+        m_encoder.reset();
+        return false;
+    }
+
+    m_running = true;
+    m_accept_thread = std::thread(&PreviewServer::accept_loop, this);
+    m_encode_thread = std::thread(&PreviewServer::encode_loop, this);
+    return true;
+}
+
+void PreviewServer::stop() {
+    if (!m_accept_thread.joinable()) return;
+    m_running = false;
+    m_pending_cv.notify_all();
+    m_accept_thread.join();
+    m_encode_thread.join();
+    ::close(m_socket);
+    m_socket = -1;
+    for (int client : m_clients) ::close(client);
+    m_clients.clear();
+    m_client_count = 0;
+    m_encoder.reset();
+}
+
+void PreviewServer::offer(const cv::Mat& frame, const PreviewOverlay& overlay, Clock::time_point now) {
+    std::unique_lock<std::mutex> lock(m_pending_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || m_has_pending) return; // 前のフレームをまだ処理している
+    frame.copyTo(m_pending); // 2回目からは確保しない
+    m_pending_overlay = overlay;
+    m_has_pending = true;
+    m_next_frame.store((now + interval(m_client_count)).time_since_epoch().count(), std::memory_order_relaxed);
+    lock.unlock();
+    m_pending_cv.notify_one();
+}
+
+// 1人なら fps、N 人なら fps / N (min_fps より下げない)
+PreviewServer::Clock::duration PreviewServer::interval(int clients) const {
+    int fps = std::max(m_params.min_fps, m_params.fps / std::max(1, clients));
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / std::max(1, fps);
+}
+
+void PreviewServer::accept_loop() {
+    while (m_running) {
+        int client = http_accept(m_socket, ACCEPT_POLL_MS, m_params.send_timeout);
+        if (client < 0) continue;
+        handle_request(client);
+    }
+}
+
+// GET / (か /stream) なら multipart のヘッダーを返して見ている人に加える。それ以外は返して閉じる
+void PreviewServer::handle_request(int client) {
+    HttpRequest request;
+    const char* error = nullptr;
+    if (!http_read_request(client, request)) {
+        error = "400 Bad Request";
+    } else if (request.method != "GET") {
+        error = "405 Method Not Allowed";
+    } else if (request.path != "/" && request.path != "/stream") {
+        error = "404 Not Found";
+    }
+    if (error) {
+        http_send_status(client, error);
+        ::close(client);
+        return;
+    }
+
+    // 送るあいだは m_clients_mutex を持たない (遅い相手のせいでプレビューのスレッドを待たせない)
+    // 人を足すのはこのスレッドだけなので、確かめてから足すまでに max_clients を超えることはない
+    if (m_client_count >= m_params.max_clients) {
+        http_send_status(client, "503 Service Unavailable");
+        ::close(client);
+        return;
+    }
+    std::string header = std::string("HTTP/1.0 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=") + BOUNDARY
+                         + "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+    if (!http_send_all(client, header)) {
+        ::close(client);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_clients_mutex);
+    m_clients.push_back(client);
+    m_client_count = static_cast<int>(m_clients.size());
+}
+
+void PreviewServer::encode_loop() {
+    cv::Mat frame, small, bgr;
+    PreviewOverlay overlay;
+    std::vector<uint8_t> jpeg;
+    while (m_running) {
+        {
+            std::unique_lock<std::mutex> lock(m_pending_mutex);
+            m_pending_cv.wait(lock, [this] { return m_has_pending || !m_running; });
+            if (!m_running) break;
+            cv::swap(frame, m_pending); // 画素はコピーしない (次の offer() は前の frame のバッファに書く)
+            overlay = m_pending_overlay;
+            m_has_pending = false;
+        }
+
+        cv::resize(frame, small, m_preview_size, 0, 0, cv::INTER_AREA);
+        if (small.channels() == 1) {
+            cv::cvtColor(small, bgr, cv::COLOR_GRAY2BGR); // v4l2 のカメラは輝度だけ。枠を色で描くため
+        } else {
+            small.copyTo(bgr);
+        }
+        draw(bgr, overlay);
+        if (!m_encoder->encode(bgr, jpeg)) continue;
+        send_frame(jpeg);
+    }
+}
+
+void PreviewServer::draw(cv::Mat& image, const PreviewOverlay& overlay) const {
+    const double sx = static_cast<double>(m_preview_size.width) / m_frame_size.width;
+    const double sy = static_cast<double>(m_preview_size.height) / m_frame_size.height;
+    if (!overlay.face.empty()) {
+        cv::Rect face(cvRound(overlay.face.x * sx), cvRound(overlay.face.y * sy), cvRound(overlay.face.width * sx),
+                      cvRound(overlay.face.height * sy));
+        cv::rectangle(image, face, cv::Scalar(0, 255, 0), 1);
+    }
+    if (overlay.nose.x >= 0) {
+        cv::circle(image, cv::Point(cvRound(overlay.nose.x * sx), cvRound(overlay.nose.y * sy)), 3, cv::Scalar(0, 0, 255), -1);
+    }
+
+    char text[96];
+    if (overlay.distance_cm > 0) {
+        std::snprintf(text, sizeof(text), "%s id %d  %.0f cm", overlay.rate_state, overlay.target_id, overlay.distance_cm);
+    } else {
+        std::snprintf(text, sizeof(text), "%s id %d  -- cm", overlay.rate_state, overlay.target_id);
+    }
+    cv::putText(image, text, cv::Point(4, 14), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0, 0, 0), 3);
+    cv::putText(image, text, cv::Point(4, 14), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255), 1);
+}
+
+// 同じ JPEG を全員に送る。送れなかった人 (閉じた・遅すぎる) は外す
+// 送るのは m_clients の写しに対して、m_clients_mutex を離してから (accept のスレッドを send_timeout の間待たせない)
+// 人を外して close() するのはこのスレッドだけなので、写しの fd は送っているあいだ閉じられない
+void PreviewServer::send_frame(const std::vector<uint8_t>& jpeg) {
+    char part[128];
+    int part_length = std::snprintf(part, sizeof(part), "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                                    BOUNDARY, jpeg.size());
+    std::vector<int> clients;
+    {
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        clients = m_clients;
+    }
+    std::vector<int> failed;
+    for (int client : clients) {
+        bool ok = http_send_all(client, part, static_cast<size_t>(part_length))
+                  && http_send_all(client, reinterpret_cast<const char*>(jpeg.data()), jpeg.size())
+                  && http_send_all(client, "\r\n", 2);
+        if (!ok) failed.push_back(client);
+    }
+    if (failed.size() < clients.size()) ++m_frames_sent;
+    if (failed.empty()) return;
+
+    std::lock_guard<std::mutex> lock(m_clients_mutex);
+    for (int client : failed) {
+        m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), client), m_clients.end());
+        ::close(client);
+    }
+    m_client_count = static_cast<int>(m_clients.size());
+}
@@ -0,0 +1,127 @@
+#pragma once
+// 追跡の様子を見るためのプレビュー (MJPEG over HTTP)
+//
+// ブラウザで http://raspberrypi.local:8080/ を開くと、検出の枠・鼻の位置・距離を描いた縮小画像が
+// multipart/x-mixed-replace で流れてくる (表示の無い Pi でも、imshow のように追跡を止めずに見られる)。
+// 検出スレッドは wants_frame() で要るかどうかだけを見て、要るときだけ offer() で最新のフレームを渡す。
+// offer() は空いていれば画像を1回コピーするだけで、縮小・枠の描画・JPEG への変換・送信はプレビューの
+// スレッドが行う (符号化が追いつかなければそのフレームは渡さずに捨てる)。見ている人がいなければ
+// wants_frame() が atomic を1つ読んで false を返すだけなので、追跡の fps は変わらない。
+// 1つの JPEG を全員に送るので、fps は見ている人数で割る (最低 min_fps)。帯域は人数に比例しない。
+// JPEG の変換は JpegEncoder で、Raspberry Pi のハードウェアのエンコーダー (V4L2 M2M, bcm2835-codec) が
+// あればそれを、無ければ (Pi 5 など) OpenCV の imencode (libjpeg-turbo) を使う。
+// port が 0 なら start() は何もしない (既定は無効。設定ファイルの preview_port で有効にする)。
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// プレビューの設定 (要調整)
+struct PreviewParams {
+    int port = 0;                       // 待ち受ける TCP のポート (0 = 無効)
+    std::string address = "0.0.0.0";    // 待ち受けるアドレス
+    int width = 320;                    // 送る画像の幅 (高さは元の縦横比から決める)
+    int fps = 10;                       // 見ている人が1人のときのフレームレート
+    int min_fps = 2;                    // 人数が増えてもこれより下げない
+    int max_clients = 4;                // 同時に見られる人数 (それ以上は 503)
+    int jpeg_quality = 70;              // JPEG の画質 (1-100)
+    std::string encoder = "auto";       // "auto" (v4l2 が使えればそれ), "v4l2", "opencv"
+    std::string encoder_device = "/dev/video31"; // V4L2 M2M の JPEG エンコーダー (bcm2835-codec の encode_image)
+    std::chrono::milliseconds send_timeout{1000}; // これより送れない相手は切る
+};
+
+// JPEG への変換
+class JpegEncoder {
+public:
+    virtual ~JpegEncoder() = default;
+
+    virtual const char* name() const = 0;
+    // size の画像を変換する準備をする。失敗したら false
+    virtual bool open(const cv::Size& size) = 0;
+    // BGR (CV_8UC3) の画像を JPEG にして out に入れる。失敗したら false
+    virtual bool encode(const cv::Mat& bgr, std::vector<uint8_t>& out) = 0;
+};
+
+// params.encoder の JpegEncoder を作って size で開く。"auto" なら v4l2 を試して、駄目なら opencv
+// 知らない名前か開けなければ nullptr
+std::unique_ptr<JpegEncoder> make_jpeg_encoder(const PreviewParams& params, const cv::Size& size);
+
+// フレームに描き込む検出結果 (座標は元のフレームのもの)
+struct PreviewOverlay {
+    cv::Rect face;                  // 検出した顔 (無ければ空)
+    cv::Point nose{-1, -1};         // 追っている点 (無ければ (-1, -1))
+    int target_id = 0;              // 追跡中の目標の番号 (0 = 追跡していない)
+    float distance_cm = -1.0f;      // フィルタした距離 (-1 = 測れていない)
+    const char* rate_state = "";    // 検出の頻度の状態 (RateScheduler)
+};
+
+class PreviewServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PreviewServer(const PreviewParams& params = PreviewParams());
+    ~PreviewServer();
+
+    PreviewServer(const PreviewServer&) = delete;
+    PreviewServer& operator=(const PreviewServer&) = delete;
+
+    // frame_size (カメラの解像度) のフレームを受けて待ち受けを始める。失敗したら false (エラーを表示する)
+    bool start(const cv::Size& frame_size);
+    void stop();
+
+    // 今フレームを渡すべきなら true (見ている人がいて、前に渡してから間隔が空いた)。ブロックしない
+    bool wants_frame(Clock::time_point now) const {
+        return m_client_count.load(std::memory_order_relaxed) > 0
+            && now.time_since_epoch().count() >= m_next_frame.load(std::memory_order_relaxed);
+    }
+    // 最新のフレーム (BGR かグレースケール) を渡す。プレビューのスレッドが前のフレームを処理中なら何もしない
+    void offer(const cv::Mat& frame, const PreviewOverlay& overlay, Clock::time_point now);
+
+    bool running() const { return m_accept_thread.joinable(); }
+    int clients() const { return m_client_count; }
+    // 送ったフレームの数
+    uint64_t frames_sent() const { return m_frames_sent; }
+    const char* encoder_name() const { return m_encoder ? m_encoder->name() : "none"; }
+
+    const PreviewParams& params() const { return m_params; }
+
+private:
+    void accept_loop();
+    void encode_loop();
+    void handle_request(int client);
+    void draw(cv::Mat& image, const PreviewOverlay& overlay) const;
+    void send_frame(const std::vector<uint8_t>& jpeg);
+    Clock::duration interval(int clients) const;
+
+    PreviewParams m_params;
+    cv::Size m_frame_size;   // 元のフレーム
+    cv::Size m_preview_size; // 送る画像
+    std::unique_ptr<JpegEncoder> m_encoder;
+    int m_socket = -1;
+    std::atomic<bool> m_running{false};
+    std::thread m_accept_thread;
+    std::thread m_encode_thread;
+
+    // 見ている人 (accept のスレッドが足し、送れなくなった人はプレビューのスレッドが外す)
+    std::mutex m_clients_mutex;
+    std::vector<int> m_clients;
+    std::atomic<int> m_client_count{0};
+
+    // 検出スレッド → プレビューのスレッド (offer() は try_lock なので待たない)
+    std::mutex m_pending_mutex;
+    std::condition_variable m_pending_cv;
+    cv::Mat m_pending;
+    PreviewOverlay m_pending_overlay;
+    bool m_has_pending = false;
+    std::atomic<Clock::rep> m_next_frame{0}; // 次にフレームを受け取る時刻 (Clock の time_since_epoch)
+
+    std::atomic<uint64_t> m_frames_sent{0};
+};
@@ -0,0 +1,175 @@
+#include "range_calibration.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <dirent.h>
+
+namespace {
+
+// DS18B20 の w1_slave は2行: "... crc=xx YES" と "... t=23125" (ミリ℃)
+bool read_ds18b20(const std::string& devices_dir, float& celsius) {
+    DIR* dir = opendir(devices_dir.c_str());
+    if (!dir) return false;
+    std::string device;
+    while (dirent* entry = readdir(dir)) {
+        if (std::string(entry->d_name).compare(0, 3, "28-") == 0) {
+            device = entry->d_name;
+            break;
+        }
+    }
+    closedir(dir);
+    if (device.empty()) return false;
+
+    std::ifstream file(devices_dir + "/" + device + "/w1_slave");
+    std::string crc_line, value_line;
+    if (!std::getline(file, crc_line) || !std::getline(file, value_line)) return false;
+    if (crc_line.find("YES") == std::string::npos) return false; // CRC エラー
+    size_t pos = value_line.find("t=");
+    if (pos == std::string::npos) return false;
+    celsius = std::strtol(value_line.c_str() + pos + 2, nullptr, 10) / 1000.0f;
+    return true;
+}
+
+bool read_millidegrees(const std::string& path, float& celsius) {
+    std::ifstream file(path);
+    long millidegrees = 0;
+    if (!(file >> millidegrees)) return false;
+    celsius = millidegrees / 1000.0f;
+    return true;
+}
+
+}
+
+float speed_of_sound_cm_per_s(float celsius) {
+    return 33130.0f + 60.6f * celsius;
+}
+
+float read_air_temperature(const RangeCalibrationParams& params, std::string& source) {
+    float celsius = 0.0f;
+    if (read_ds18b20(params.w1_devices_dir, celsius)) {
+        source = "ds18b20";
+        return celsius;
+    }
+    if (read_millidegrees(params.soc_thermal_path, celsius)) {
+        source = "soc";
+        return celsius - params.soc_offset;
+    }
+    source = "default";
+    return params.default_temp;
+}
+
+EchoConverter::EchoConverter(const RangeCalibrationParams& params)
+    : m_params(params), m_reference_temp(params.table_temp), m_temperature(params.table_temp) {
+    build({}); // load() を呼ぶまでは音速だけで変換する
+}
+
+bool EchoConverter::load() {
+    std::ifstream file(m_params.table_path);
+    if (!file) { // 校正表が無い個体は音速だけで計算する
+        m_reference_temp = m_params.table_temp;
+        m_calibrated = false;
+        build({});
+        set_temperature(m_temperature);
+        return true;
+    }
+
+    struct Point {
+        float echo_us;
+        float distance_cm;
+        int line_no;
+    };
+    std::vector<Point> rows;
+    float reference_temp = m_params.table_temp;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            std::istringstream header(line.substr(comment + 1));
+            std::string key;
+            float value;
+            if (header >> key >> value && key == "temperature") reference_temp = value;
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        float echo_us, distance_cm;
+        if (!(fields >> echo_us)) continue; // 空行
+        if (!(fields >> distance_cm)) {
+            std::cerr << "ERROR: " << m_params.table_path << ":" << line_no << ": expected <echo_us> <distance_cm>\n";
+            return false;
+        }
+        rows.push_back({echo_us, distance_cm, line_no});
+    }
+    std::sort(rows.begin(), rows.end(), [](const Point& a, const Point& b) { return a.echo_us < b.echo_us; });
+    // 変換表は単調増加でないと to_echo_us() の二分探索と表の先の延長が壊れるので、距離も増えていること
+    for (size_t i = 1; i < rows.size(); ++i) {
+        if (rows[i].echo_us <= rows[i - 1].echo_us) {
+            std::cerr << "ERROR: " << m_params.table_path << ":" << rows[i].line_no << ": duplicate echo time "
+                      << rows[i].echo_us << " us (also at line " << rows[i - 1].line_no << ")\n";
+            return false;
+        }
+        if (rows[i].distance_cm <= rows[i - 1].distance_cm) {
+            std::cerr << "ERROR: " << m_params.table_path << ":" << rows[i].line_no << ": distance " << rows[i].distance_cm
+                      << " cm at " << rows[i].echo_us << " us is not greater than " << rows[i - 1].distance_cm
+                      << " cm at line " << rows[i - 1].line_no << " (distances must increase with echo time)\n";
+            return false;
+        }
+    }
+    if (rows.size() < 2) {
+        std::cerr << "ERROR: " << m_params.table_path << ": need at least 2 calibration points\n";
+        return false;
+    }
+    std::vector<std::pair<float, float>> points; // (パルス幅 us, 距離 cm)
+    for (const Point& row : rows) points.emplace_back(row.echo_us, row.distance_cm);
+
+    m_reference_temp = reference_temp;
+    m_calibrated = true;
+    build(points);
+    set_temperature(m_temperature);
+    return true;
+}
+
+void EchoConverter::set_temperature(float celsius) {
+    m_temperature = celsius;
+    m_scale.store(speed_of_sound_cm_per_s(celsius) / speed_of_sound_cm_per_s(m_reference_temp),
+                  std::memory_order_relaxed);
+}
+
+uint32_t EchoConverter::to_echo_us(float distance_cm) const {
+    float cm = distance_cm / m_scale.load(std::memory_order_relaxed); // 表の気温での距離に直す
+    // 表は単調増加なので二分探索で超える位置を探す
+    auto it = std::lower_bound(m_table.begin(), m_table.end(), cm);
+    if (it == m_table.end()) {
+        float extra_us = m_tail_cm_per_us > 0.0f ? (cm - m_table.back()) / m_tail_cm_per_us : 0.0f;
+        return static_cast<uint32_t>((m_table.size() - 1) * STEP_US + extra_us);
+    }
+    return static_cast<uint32_t>((it - m_table.begin()) * STEP_US);
+}
+
+// 校正点を折れ線で結んだ表を作る (点が無ければ表の気温の音速の直線)
+// 校正点の範囲の外は、両端の区間をそのまま延ばす
+void EchoConverter::build(const std::vector<std::pair<float, float>>& points) {
+    const size_t size = m_params.max_echo_us / STEP_US + 1;
+    m_table.resize(size);
+    if (points.size() < 2) {
+        m_tail_cm_per_us = speed_of_sound_cm_per_s(m_reference_temp) / 2.0f / 1000000.0f; // 往復なので /2
+        for (size_t i = 0; i < size; ++i) m_table[i] = i * STEP_US * m_tail_cm_per_us;
+        return;
+    }
+
+    size_t segment = 0;
+    for (size_t i = 0; i < size; ++i) {
+        float echo_us = static_cast<float>(i * STEP_US);
+        while (segment + 2 < points.size() && echo_us > points[segment + 1].first) ++segment;
+        const auto& a = points[segment];
+        const auto& b = points[segment + 1];
+        m_table[i] = std::max(0.0f, a.second + (b.second - a.second) * (echo_us - a.first) / (b.first - a.first));
+    }
+    const auto& a = points[points.size() - 2];
+    const auto& b = points.back();
+    m_tail_cm_per_us = (b.second - a.second) / (b.first - a.first);
+}
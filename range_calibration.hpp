@@ -0,0 +1,80 @@
+#pragma once
+// 超音波の Echo パルス幅 (us) から距離 (cm) への変換と、音速の気温補正
+//
+// 音速は気温で変わる (331.3 + 0.606×T m/s。夏と冬で 2〜3% 違う) ので、気温を測って補正する。
+// 気温は DS18B20 (1-Wire, /sys/bus/w1/devices/28-*) から読み、無ければ SoC の温度から推定する。
+// 個体ごとの校正表 (実測したパルス幅と距離の組) があれば、それを折れ線で補間して使う。
+// 変換は起動時に作った表を引いて、気温による係数を1回掛けるだけにしてある (アラートスレッドで呼ばれる)。
+//
+// 校正表のファイル (1行に「パルス幅(us) 距離(cm)」, # から後はコメント):
+//   # temperature 22.5     ← 測ったときの気温 (無ければ table_temp)
+//   588 10.0
+//   1170 20.0
+//   ...
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 変換の設定値
+struct RangeCalibrationParams {
+    std::string table_path = "calibration/ultrasonic.txt"; // 校正表 (無ければ音速だけで計算する)
+    float table_temp = 20.0f;       // 校正表を測ったときの気温 (℃, 表に "# temperature" があればそちら)
+    uint32_t max_echo_us = 30000;   // 表を作る範囲 (これより長いパルスは最後の区間を延ばして計算する)
+
+    std::string w1_devices_dir = "/sys/bus/w1/devices"; // DS18B20 (28-xxxxxxxxxxxx) を探す場所
+    std::string soc_thermal_path = "/sys/class/thermal/thermal_zone0/temp";
+    float soc_offset = 15.0f;       // SoC の温度から気温を推定するときに引く値 (ケースや負荷で変わる, 要調整)
+    float default_temp = 20.0f;     // どちらも読めないときの気温
+};
+
+// 気温 celsius (℃) での音速 (cm/s)
+float speed_of_sound_cm_per_s(float celsius);
+
+// 気温を読む。source に読んだもの ("ds18b20", "soc", "default") を入れる
+// DS18B20 は読むたびに変換を待つので 1 秒近くかかることがある (測距やカメラのスレッドからは呼ばないこと)
+float read_air_temperature(const RangeCalibrationParams& params, std::string& source);
+
+class EchoConverter {
+public:
+    static constexpr uint32_t STEP_US = 8; // 表の刻み (音速で 0.14cm 分)
+
+    explicit EchoConverter(const RangeCalibrationParams& params = RangeCalibrationParams());
+
+    // 校正表があれば読み込んで変換表を作る。表が無ければ音速だけで作る
+    // 表が読めない・点が2つ未満・パルス幅か距離が増えていないときは false (エラーを表示する)
+    bool load();
+    // 校正表を使っているなら true
+    bool calibrated() const { return m_calibrated; }
+
+    // 今の気温を設定する (他のスレッドから呼んでよい)
+    void set_temperature(float celsius);
+    float temperature() const { return m_temperature; }
+
+    // パルス幅 (往復, us) → 距離 (cm)
+    float to_cm(uint32_t echo_us) const {
+        size_t i = echo_us / STEP_US;
+        float cm;
+        if (i + 1 < m_table.size()) {
+            float frac = static_cast<float>(echo_us % STEP_US) / STEP_US;
+            cm = m_table[i] + (m_table[i + 1] - m_table[i]) * frac;
+        } else {
+            cm = m_table.back() + (echo_us - (m_table.size() - 1) * STEP_US) * m_tail_cm_per_us;
+        }
+        return cm * m_scale.load(std::memory_order_relaxed);
+    }
+    // 距離 (cm) → パルス幅 (往復, us)。今の気温で distance_cm までの往復にかかる時間
+    uint32_t to_echo_us(float distance_cm) const;
+
+private:
+    void build(const std::vector<std::pair<float, float>>& points);
+
+    RangeCalibrationParams m_params;
+    std::vector<float> m_table;     // STEP_US ごとの距離 (校正表を測った気温での値)
+    float m_tail_cm_per_us = 0.0f;  // 表より長いパルスの傾き
+    float m_reference_temp;         // 表の気温
+    bool m_calibrated = false;
+    std::atomic<float> m_scale{1.0f}; // 今の音速 / 表の音速
+    std::atomic<float> m_temperature;
+};
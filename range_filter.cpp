@@ -0,0 +1,78 @@
+#include "range_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+RangeFilter::RangeFilter(const RangeFilterParams& params) : m_params(params) {
+    m_params.window = std::min(std::max<size_t>(m_params.window, 1), MAX_WINDOW);
+}
+
+bool RangeFilter::add(float distance_cm, bool valid, uint32_t tick) {
+    if (valid) {
+        m_samples[m_head] = {distance_cm, tick};
+        m_head = (m_head + 1) % m_params.window;
+        m_count = std::min(m_count + 1, m_params.window);
+    }
+
+    // 新しい順に見て、古すぎる測定値から先は捨てる
+    std::array<float, MAX_WINDOW> values;
+    size_t fresh = 0;
+    for (size_t i = 0; i < m_count; ++i) {
+        const Sample& sample = m_samples[(m_head + m_params.window - 1 - i) % m_params.window];
+        if (tick - sample.tick > m_params.max_age_us) break; // 符号なし減算で tick の桁あふれも吸収
+        values[fresh++] = sample.distance_cm;
+    }
+    m_count = fresh;
+    if (fresh < m_params.min_samples) {
+        m_valid = false;
+        return false;
+    }
+
+    std::nth_element(values.begin(), values.begin() + fresh / 2, values.begin() + fresh);
+    float median = values[fresh / 2];
+    bool outlier = valid && std::abs(distance_cm - median) > std::max(m_params.outlier_cm, median * m_params.outlier_ratio);
+    if (!valid || outlier) {
+        if (!m_valid) { // EMA がまだ無ければ中央値から始める
+            m_ema_cm = median;
+            m_valid = true;
+        }
+        return outlier;
+    }
+
+    m_ema_cm = m_valid ? m_ema_cm + m_params.ema_alpha * (median - m_ema_cm) : median;
+    m_valid = true;
+    return false;
+}
+
+void RangeFilter::reset() {
+    m_count = 0;
+    m_head = 0;
+    m_valid = false;
+}
+
+bool ProximityWake::update(bool valid, float distance_cm) {
+    if (!m_params.enabled) return false;
+    if (!valid) {
+        m_has_baseline = false;
+        m_armed = true;
+        return false;
+    }
+    bool near = distance_cm < m_params.max_distance_cm
+                && (!m_has_baseline || m_baseline_cm - distance_cm >= m_params.approach_cm);
+    bool wake = near && m_armed;
+    m_armed = !near; // 基準が追いついて近づいていない状態に戻ったら、また知らせる
+    m_baseline_cm = m_has_baseline ? m_baseline_cm + m_params.baseline_alpha * (distance_cm - m_baseline_cm) : distance_cm;
+    m_has_baseline = true;
+    return wake;
+}
+
+bool ProximityAlarm::update(bool valid, float distance_cm) {
+    if (!valid) {
+        m_active = false;
+    } else if (distance_cm < m_on_cm) {
+        m_active = true;
+    } else if (distance_cm > m_off_cm) {
+        m_active = false;
+    }
+    return m_active;
+}
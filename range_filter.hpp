@@ -0,0 +1,98 @@
+#pragma once
+// 超音波の測定値のフィルタと、近すぎる警告の判定
+//
+// RangeFilter は直近 window 回の測定値 (時刻つき) をリングバッファに持ち、
+// 中央値をとってから指数移動平均 (EMA) で滑らかにする。中央値から大きく外れた1回だけの値 (外れ値) は
+// EMA に入れない (本当に距離が変わったのなら、続く測定で中央値の方が動く)。
+// 古い測定値 (max_age より前) は使わないので、しばらく測れなければ無効になる。
+// UltrasonicRanger が結果を出すたびに (アラートスレッドで) 通すので、読む側には遅延が増えない。
+//
+// ProximityAlarm は警告の ON/OFF をヒステリシスつきで決める (しきい値付近で LED がちらつかない)。
+// ProximityWake は何かが近づいてきたことを知らせる (Idle の顔検出を起こす)。
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// フィルタの調整値 (要調整)
+struct RangeFilterParams {
+    size_t window = 5;            // 中央値をとる測定回数 (MAX_WINDOW まで)
+    float ema_alpha = 0.4f;       // EMA の係数 (0-1, 大きいほど新しい値を重視)
+    float outlier_cm = 20.0f;     // 中央値からこれ以上離れた値は外れ値 (近い距離での最小幅)
+    float outlier_ratio = 0.25f;  // 中央値のこの割合以上離れた値も外れ値 (遠い距離では幅を広げる)
+    uint32_t max_age_us = 500000; // これより古い測定値は使わない
+    size_t min_samples = 3;       // 有効な測定値がこれより少なければ結果は無効
+};
+
+class RangeFilter {
+public:
+    static constexpr size_t MAX_WINDOW = 16;
+
+    explicit RangeFilter(const RangeFilterParams& params = RangeFilterParams());
+
+    // 1回分の測定値を入れる。valid が false (タイムアウト・範囲外) のときは古い値を捨てるだけ
+    // tick は測定した時刻 (us, 桁あふれしてよい)。外れ値として捨てたら true
+    bool add(float distance_cm, bool valid, uint32_t tick);
+    void reset();
+
+    // フィルタした距離。valid() が false のときは意味が無い
+    float distance_cm() const { return m_ema_cm; }
+    bool valid() const { return m_valid; }
+
+    const RangeFilterParams& params() const { return m_params; }
+
+private:
+    struct Sample {
+        float distance_cm;
+        uint32_t tick;
+    };
+
+    RangeFilterParams m_params;
+    std::array<Sample, MAX_WINDOW> m_samples{}; // リングバッファ (有効な測定値だけ)
+    size_t m_head = 0;  // 次に書く位置
+    size_t m_count = 0;
+    float m_ema_cm = 0.0f;
+    bool m_valid = false;
+};
+
+// 近すぎる警告 (ヒステリシスつき)
+// threshold_cm より近くなったら ON、threshold_cm + hysteresis_cm より遠くなるか測れなくなったら OFF
+class ProximityAlarm {
+public:
+    ProximityAlarm(float threshold_cm, float hysteresis_cm) : m_on_cm(threshold_cm), m_off_cm(threshold_cm + hysteresis_cm) {}
+
+    // フィルタした距離で判定し直す。警告するなら true
+    bool update(bool valid, float distance_cm);
+    bool active() const { return m_active; }
+
+private:
+    float m_on_cm;
+    float m_off_cm;
+    bool m_active = false;
+};
+
+// 近づいてきた物の判定の設定 (要調整)
+struct ProximityWakeParams {
+    bool enabled = true;
+    float max_distance_cm = 150.0f; // これより近いときだけ知らせる
+    float approach_cm = 15.0f;      // 基準の距離よりこれだけ近くなったら知らせる
+    float baseline_alpha = 0.05f;   // 基準の距離の EMA の係数 (測定ごと。止まっている物にはすぐ追いつく)
+};
+
+// 近づいてきた物の判定
+// フィルタした距離を、ゆっくり追う基準の距離 (EMA) と比べ、approach_cm 以上近くなったら1回だけ知らせる。
+// 止まっている壁や机は基準がその距離になるので、何度も知らせない。測れない (何も無い) 状態から
+// max_distance_cm より近くに何かが現れたときも知らせる。
+class ProximityWake {
+public:
+    explicit ProximityWake(const ProximityWakeParams& params = ProximityWakeParams()) : m_params(params) {}
+
+    // 新しいフィルタした距離で判定する。近づいてきたら true (近いまま止まっている間は、もう1度は知らせない)
+    bool update(bool valid, float distance_cm);
+
+private:
+    ProximityWakeParams m_params;
+    float m_baseline_cm = 0.0f;
+    bool m_has_baseline = false; // false = 何も測れていない (近くに何も無い)
+    bool m_armed = true;         // 次に近づいたら知らせる
+};
@@ -0,0 +1,94 @@
+// Ras-Eye: 顔を追うカメラと超音波センサーによる近接警告
+//
+// 1つのプログラムで、起動時にモードを選ぶ (各モードの中身は mode_*.cpp)。
+// 調整値は設定ファイル (既定は ras_eye.conf, 書式は config.hpp) に書けば再コンパイルが要らない。
+//
+// 使い方: ./ras_eye <track|range-only|bench> [--config=PATH] [--log-level=debug|info|warning|error] [各モードの引数...]
+//   track       顔の追跡とパン・チルト・警告 (旧 ras_eye02)
+//   range-only  超音波センサーと LED だけ (旧 tyouonpa01)
+//   bench       録画での速度の測定 (旧 ras_eye_bench)
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include "config.hpp"
+#include "log.hpp"
+#include "modes.hpp"
+#include "settings.hpp"
+
+const char* DEFAULT_CONFIG_PATH = "ras_eye.conf"; // 起動したフォルダから見たパス
+
+// モードごとに受け付ける引数 ("=" で終わるものは値つき)。どのモードでも --config= と --log-level= は使える
+const std::map<std::string, std::vector<std::string>> MODE_ARGS = {
+    {"track", {"--gpio=", "--detector=", "--detect-threads=", "--target=", "--camera=", "--preprocess="}},
+    {"range-only", {"--gpio="}},
+    {"bench", {"--detector=", "--detect-threads=", "--target=", "--preprocess=", "--gray", "--no-motion-gate"}},
+};
+
+void print_usage(const char* program) {
+    std::cerr << "usage: " << program << " <track|range-only|bench> [--config=PATH] [--log-level=debug|info|warning|error] [options]\n"
+              << "  track       [--gpio=NAME] [--detector=NAME] [--detect-threads=N] [--target=POLICY] [--camera=opencv|v4l2] [--preprocess=MODE]\n"
+              << "  range-only  [--gpio=NAME]\n"
+              << "  bench       <video file | image directory> [max frames] [--detector=NAME|all] [--detect-threads=N] [--target=POLICY]\n"
+              << "              [--preprocess=MODE|all] [--gray] [--no-motion-gate]\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string mode = argv[1];
+    auto mode_args = MODE_ARGS.find(mode);
+    if (mode_args == MODE_ARGS.end()) {
+        std::cerr << "ERROR: Unknown mode [" << mode << "] (available: track, range-only, bench)\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+    // 知らない引数は無視せずに止める (綴りを間違えると、設定ファイルの値のまま動いてしまう)
+    std::vector<std::string> known = mode_args->second;
+    known.insert(known.end(), {"--config=", "--log-level="});
+    if (!check_args(argc, argv, known)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 既定の設定ファイルは無くてよい (すべて既定値)。--config= で指定したものが無ければエラー
+    Config config;
+    std::string config_path = arg_value(argc, argv, "--config=", "");
+    if (config_path.empty()) {
+        struct stat st;
+        if (stat(DEFAULT_CONFIG_PATH, &st) == 0) config_path = DEFAULT_CONFIG_PATH;
+    }
+    if (!config_path.empty() && !config.load(config_path)) return 1;
+
+    // 表示は非同期のログ (log.hpp) に渡す。--log-level= は設定ファイルの log_level より優先する
+    LogParams log_params;
+    std::string log_level = arg_value(argc, argv, "--log-level=", config.get_string("log_level", "info"));
+    if (!parse_log_level(log_level, log_params.min_level)) {
+        std::cerr << "ERROR: Unknown log level [" << log_level << "] (available: debug, info, warning, error)\n";
+        return 1;
+    }
+    log_params.min_interval = std::chrono::milliseconds(
+        config.get_int("log_min_interval_ms", static_cast<int>(log_params.min_interval.count())));
+    warn_unknown_keys(config);
+    if (config.has_errors()) return 1; // 使えない値 (downscale = 0 など) のまま動かさない
+    logger().start(log_params);
+
+    // モード名を除いた引数を渡す (argv[0] はそのまま)
+    argv[1] = argv[0];
+    int result;
+    if (mode == "track") {
+        result = run_track(config, argc - 1, argv + 1);
+    } else if (mode == "range-only") {
+        result = run_range_only(config, argc - 1, argv + 1);
+    } else {
+        result = run_bench(config, argc - 1, argv + 1);
+    }
+    logger().stop(); // 残っている表示を書き出す
+    return result;
+}
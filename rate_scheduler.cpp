@@ -0,0 +1,96 @@
+#include "rate_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "log.hpp"
+
+RateScheduler::RateScheduler(const RateSchedulerParams& params)
+    : m_params(params), m_temperature(NAN), m_last_activity(Clock::now()) {}
+
+void RateScheduler::update(bool tracking, bool activity, Clock::duration busy, Clock::time_point now) {
+    double busy_us = std::chrono::duration<double, std::micro>(busy).count();
+    m_busy_us = m_busy_us == 0.0 ? busy_us : m_busy_us + m_params.latency_smoothing * (busy_us - m_busy_us);
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        if (m_wake_requested) activity = true; // 超音波で近づいてきた物を見た (まだ画面に動きが無くても探す)
+        m_wake_requested = false;
+    }
+
+    if (tracking || activity) m_last_activity = now;
+    if (tracking) {
+        m_state = State::Locked;
+    } else if (now - m_last_activity < m_params.idle_after) {
+        m_state = State::Searching;
+    } else {
+        m_state = State::Idle;
+    }
+
+    if (now >= m_next_thermal_poll) {
+        poll_thermal();
+        m_next_thermal_poll = now + m_params.thermal_poll;
+    }
+}
+
+RateScheduler::Clock::duration RateScheduler::interval() const {
+    Clock::duration base;
+    switch (m_state.load()) {
+    case State::Idle: base = m_params.idle_interval; break;
+    case State::Searching: base = m_params.searching_interval; break;
+    default: // Locked: 検出が間に合う限り速く回す
+        base = std::max<Clock::duration>(m_params.locked_interval,
+                                         std::chrono::microseconds(static_cast<int64_t>(m_busy_us)));
+        break;
+    }
+    return std::chrono::duration_cast<Clock::duration>(base * static_cast<double>(m_backoff));
+}
+
+void RateScheduler::sleep_until(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    m_wake_cv.wait_until(lock, deadline, [this] { return m_wake_requested; });
+}
+
+void RateScheduler::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        if (m_wake_requested) return;
+        m_wake_requested = true;
+    }
+    if (m_state == State::Idle) m_wakes.fetch_add(1, std::memory_order_relaxed);
+    m_wake_cv.notify_one();
+}
+
+void RateScheduler::poll_thermal() {
+    std::ifstream file(m_params.thermal_path);
+    long millidegrees = 0;
+    if (!(file >> millidegrees)) {
+        if (!m_thermal_warned) { // 温度が読めない機種では温度による調整をしない
+            logger().warning("Could not read SoC temperature from [{}], thermal backoff disabled", m_params.thermal_path.c_str());
+            m_thermal_warned = true;
+        }
+        m_temperature = NAN;
+        m_backoff = 1.0f;
+        return;
+    }
+    float temperature = millidegrees / 1000.0f;
+    m_temperature = temperature;
+
+    // 高ければ少しずつ延ばし、十分下がったら少しずつ戻す (その間は今の倍率を保つ)
+    float backoff = m_backoff;
+    if (temperature > m_params.target_temp) {
+        backoff = std::min(m_params.max_backoff, backoff * m_params.backoff_step);
+    } else if (temperature < m_params.target_temp - m_params.thermal_hysteresis) {
+        backoff = std::max(1.0f, backoff / m_params.recover_step);
+    }
+    m_backoff = backoff;
+}
+
+const char* rate_state_name(RateScheduler::State state) {
+    switch (state) {
+    case RateScheduler::State::Idle: return "idle";
+    case RateScheduler::State::Searching: return "searching";
+    case RateScheduler::State::Locked: return "locked";
+    }
+    return "?";
+}
@@ -0,0 +1,90 @@
+#pragma once
+// 検出の頻度 (デューティ比) とカメラのフレームレートの切り替え
+//
+// 追跡の状態で処理の頻度を決める:
+//   Idle      : しばらく顔も動きも無い。idle_interval ごとに1回だけ検出し、カメラも idle_fps に落とす
+//   Searching : 動きがあった・顔を見失ったばかり。searching_interval ごとに検出する
+//   Locked    : 顔を追跡中。検出にかかる時間いっぱい (locked_interval より速くはしない) で回す
+// さらに SoC の温度 (/sys/class/thermal) を見て、target_temp を超えたら間隔を少しずつ延ばす。
+// Raspberry Pi は 80〜85℃ で勝手にクロックを落とす (fps が急に落ちる) ので、その手前で自分から控える。
+// Idle の間に超音波で何かが近づいてきたら、wake() で次の検出まで待たずに Searching に戻す
+// (Idle の間隔を長くしても、人が来たときの反応は遅れない)。
+// update() と sleep_until() は検出スレッドから呼ぶ。wake() と interval() 以外の読み出しは他のスレッドからでもよい。
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// 頻度の調整パラメータ (要調整)
+struct RateSchedulerParams {
+    std::chrono::milliseconds idle_interval{500};      // Idle のときの検出間隔 (2fps)
+    std::chrono::milliseconds searching_interval{66};  // Searching のときの検出間隔 (15fps)
+    std::chrono::milliseconds locked_interval{33};     // Locked のときの最短の検出間隔 (30fps)
+    std::chrono::milliseconds idle_after{5000};        // 顔も動きもこの時間無ければ Idle にする
+    int active_fps = 30;                                // Idle 以外のカメラのフレームレート
+    int idle_fps = 5;                                   // Idle のカメラのフレームレート
+    float latency_smoothing = 0.2f;                     // 検出時間の指数移動平均の係数 (0-1, 大きいほど新しい値を重視)
+
+    std::string thermal_path = "/sys/class/thermal/thermal_zone0/temp"; // ミリ℃ で書かれたファイル
+    std::chrono::milliseconds thermal_poll{1000};      // 温度を読む間隔
+    float target_temp = 70.0f;                          // これを超えたら間隔を延ばす (℃)
+    float thermal_hysteresis = 3.0f;                    // target_temp - これ を下回ったら間隔を戻す (℃)
+    float backoff_step = 1.1f;                          // 温度が高い間、温度を読むたびに間隔をこの倍率で延ばす
+    float recover_step = 1.05f;                         // 温度が下がったら、この倍率で戻す
+    float max_backoff = 4.0f;                           // 延ばすのはこの倍率まで
+};
+
+class RateScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { Idle, Searching, Locked };
+
+    explicit RateScheduler(const RateSchedulerParams& params = RateSchedulerParams());
+
+    // 1フレーム処理するたびに呼ぶ
+    // tracking は顔を追跡中か、activity は画面に動きがあった (検出を飛ばさなかった) か、busy はこのフレームの処理時間
+    void update(bool tracking, bool activity, Clock::duration busy, Clock::time_point now);
+
+    // 次のフレームを処理するまでの間隔 (前のフレームの処理を始めた時刻から数える)
+    Clock::duration interval() const;
+    // deadline まで休む。その間に wake() されたらすぐ返る
+    void sleep_until(Clock::time_point deadline);
+    // 何かが近づいてきた (どのスレッドから呼んでもよい)。次の update() では動きがあったものとして扱う
+    void wake();
+    // Idle から wake() で起こした回数
+    uint64_t wakes() const { return m_wakes; }
+    // カメラに要求するフレームレート
+    int camera_fps() const { return m_state == State::Idle ? m_params.idle_fps : m_params.active_fps; }
+
+    State state() const { return m_state; }
+    // 最後に読んだ SoC の温度 (℃)。読めなければ NaN
+    float temperature() const { return m_temperature; }
+    // 温度による間隔の倍率 (1 = 控えていない)
+    float backoff() const { return m_backoff; }
+
+    const RateSchedulerParams& params() const { return m_params; }
+
+private:
+    void poll_thermal();
+
+    RateSchedulerParams m_params;
+    std::atomic<State> m_state{State::Searching};
+    std::atomic<float> m_temperature;
+    std::atomic<float> m_backoff{1.0f};
+
+    Clock::time_point m_last_activity;
+    Clock::time_point m_next_thermal_poll;
+    double m_busy_us = 0.0; // 処理時間の指数移動平均
+    bool m_thermal_warned = false;
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake_cv;
+    bool m_wake_requested = false; // m_wake_mutex で守る
+    std::atomic<uint64_t> m_wakes{0};
+};
+
+const char* rate_state_name(RateScheduler::State state);
@@ -0,0 +1,56 @@
+#include "servo_output.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ServoOutput::ServoOutput(const ServoOutputParams& params) : m_params(params) {
+    m_pan.target = m_pan.pulse = params.pan.clamp(params.pan.center_pulse);
+    m_tilt.target = m_tilt.pulse = params.tilt.clamp(params.tilt.center_pulse);
+}
+
+void ServoOutput::init(GpioDevice& gpio) {
+    m_gpio = &gpio;
+    for (const ServoAxisParams* axis : {&m_params.pan, &m_params.tilt}) m_gpio->set_mode(axis->pin, GpioMode::Output);
+    // 起動時の角度だけは速さの制限をかけずにそのまま書く (どこを向いていたかは分からない)
+    m_pan.written = static_cast<unsigned>(std::lround(m_pan.pulse.load()));
+    m_tilt.written = static_cast<unsigned>(std::lround(m_tilt.pulse.load()));
+    m_gpio->servo(m_params.pan.pin, m_pan.written);
+    m_gpio->servo(m_params.tilt.pin, m_tilt.written);
+    m_last_update = Clock::now();
+}
+
+void ServoOutput::command(float pan_pulse, float tilt_pulse) {
+    m_pan.target.store(m_params.pan.clamp(pan_pulse), std::memory_order_relaxed);
+    m_tilt.target.store(m_params.tilt.clamp(tilt_pulse), std::memory_order_relaxed);
+}
+
+bool ServoOutput::update(Clock::time_point now) {
+    if (!m_gpio) return false;
+    // 間隔は呼ぶ側の固定の周期に任せる (前回起きた時刻と比べると、揺らぎで周期の半分近くを飛ばしてしまう)
+    // 止まっていた後に一気に動かないよう、経過時間は2周期分で打ち切る
+    double dt = std::min(std::chrono::duration<double>(now - m_last_update).count(),
+                         2.0 * std::chrono::duration<double>(m_params.period).count());
+    m_last_update = now;
+
+    float max_step = static_cast<float>(m_params.max_slew * dt);
+    bool pan_written = update_axis(m_pan, m_params.pan, max_step);
+    bool tilt_written = update_axis(m_tilt, m_params.tilt, max_step);
+    return pan_written || tilt_written;
+}
+
+bool ServoOutput::update_axis(Axis& axis, const ServoAxisParams& params, float max_step) {
+    float pulse = axis.pulse.load(std::memory_order_relaxed);
+    float target = axis.target.load(std::memory_order_relaxed);
+    float next = pulse + std::min(std::max(target - pulse, -max_step), max_step);
+    axis.pulse.store(next, std::memory_order_relaxed);
+
+    unsigned width = static_cast<unsigned>(std::lround(next));
+    if (width == axis.written) { // 丸めると前回と同じ
+        ++m_skipped;
+        return false;
+    }
+    m_gpio->servo(params.pin, width);
+    axis.written = width;
+    ++m_writes;
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+// サーボへの出力段 (パン・チルトの2軸)
+//
+// 制御 (PanTiltController::step()) は command() で目標のパルス幅を郵便受けに書くだけで、GPIO は触らない。
+// update() をサーボの PWM 周期 (50Hz なら 20ms) ごとに呼ぶと、郵便受けの最新の目標に向けて
+// 1周期あたり max_slew × 周期 まで動かし、パルス幅 (us 単位に丸めた値) が変わった軸だけ書き込む。
+// 呼ぶ間隔は呼ぶ側 (servo_loop の固定の周期) が守る。動かす量は前回からの実際の経過時間で決めるので、
+// 起きるのが少し遅れ・早まっても速さの上限は変わらない。
+// 端 (min_pulse, max_pulse) は軸ごとに校正した値を使う (これより外に回すとサーボが機構に当たる)。
+// command() と update() は別のスレッドから呼んでよい (郵便受けは軸ごとの atomic で、待たない)。
+// GpioDevice::initialise() の後で init() を呼ぶこと。
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "gpio_device.hpp"
+
+// 1軸分の設定 (要調整: 端はサーボを取り付けた状態で少しずつ回して決める)
+struct ServoAxisParams {
+    int pin = 17;
+    float min_pulse = 1000.0f;    // 回してよい範囲 (us)
+    float max_pulse = 2000.0f;
+    float center_pulse = 1500.0f; // 起動時の角度
+
+    float clamp(float pulse) const {
+        if (pulse < min_pulse) return min_pulse;
+        if (pulse > max_pulse) return max_pulse;
+        return pulse;
+    }
+};
+
+struct ServoOutputParams {
+    ServoAxisParams pan{17, 1000.0f, 2000.0f, 1500.0f};  // パン用サーボモーター
+    ServoAxisParams tilt{18, 1000.0f, 2000.0f, 1500.0f}; // チルト用サーボモーター
+    std::chrono::microseconds period{20000}; // サーボの PWM 周期 (gpioServo は 50Hz)
+    float max_slew = 2000.0f;                // 動かす速さの上限 (us/s, 急に動かして行き過ぎないように, 要調整)
+};
+
+class ServoOutput {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ServoOutput(const ServoOutputParams& params = ServoOutputParams());
+
+    // gpio のサーボを中央 (center_pulse) にする。以降の update() も gpio に書き込む
+    void init(GpioDevice& gpio);
+
+    // 目標のパルス幅を書く (端の範囲に収める)。待たない
+    void command(float pan_pulse, float tilt_pulse);
+    // 1周期分: 目標に向けて max_slew まで動かし、変わった軸だけ書き込む。書き込んだら true
+    // period ごとに呼ぶこと (ここでは間隔を見ない。経過時間は2周期分で打ち切る)
+    bool update(Clock::time_point now);
+
+    // 最後に書き込んだパルス幅 (サーボが今向いている角度。他のスレッドから読んでよい)
+    float pan_pulse() const { return m_pan.pulse.load(std::memory_order_relaxed); }
+    float tilt_pulse() const { return m_tilt.pulse.load(std::memory_order_relaxed); }
+
+    // 書き込んだ回数と、変わらなかったので省いた回数 (軸ごとに数える)
+    uint64_t writes() const { return m_writes; }
+    uint64_t skipped() const { return m_skipped; }
+
+    const ServoOutputParams& params() const { return m_params; }
+
+private:
+    struct Axis {
+        std::atomic<float> target{0.0f}; // 郵便受け (command() が書く)
+        std::atomic<float> pulse{0.0f};  // 出力中の角度 (update() が書く)
+        unsigned written = 0;            // 最後に書き込んだ値 (us)
+    };
+
+    bool update_axis(Axis& axis, const ServoAxisParams& params, float max_step);
+
+    ServoOutputParams m_params;
+    GpioDevice* m_gpio = nullptr;
+    Axis m_pan;
+    Axis m_tilt;
+    Clock::time_point m_last_update; // update() だけが触る
+    std::atomic<uint64_t> m_writes{0};
+    std::atomic<uint64_t> m_skipped{0};
+};
@@ -0,0 +1,131 @@
+#include "settings.hpp"
+
+#include <iostream>
+
+namespace {
+
+// prefix_pin, prefix_min_pulse, prefix_max_pulse, prefix_center_pulse
+ServoAxisParams servo_axis_params(const Config& config, const std::string& prefix, ServoAxisParams axis) {
+    axis.pin = config.get_int(prefix + "_pin", axis.pin);
+    axis.min_pulse = config.get_float(prefix + "_min_pulse", axis.min_pulse);
+    axis.max_pulse = config.get_float(prefix + "_max_pulse", axis.max_pulse);
+    axis.center_pulse = config.get_float(prefix + "_center_pulse", axis.center_pulse);
+    return axis;
+}
+
+}
+
+FaceDetectorParams face_detector_params(const Config& config) {
+    FaceDetectorParams params;
+    params.engine = config.get_string("detector", params.engine);
+    params.detect_threads = config.get_int("detect_threads", params.detect_threads);
+    params.preprocess = config.get_string("preprocess", params.preprocess);
+    params.tracker.policy = config.get_string("target", params.tracker.policy);
+    params.cascade_path = config.get_string("haar_cascade", params.cascade_path);
+    params.lbp_cascade_path = config.get_string("lbp_cascade", params.lbp_cascade_path);
+    params.yunet_model_path = config.get_string("yunet_model", params.yunet_model_path);
+    params.ssd_model_path = config.get_string("ssd_model", params.ssd_model_path);
+    params.ssd_config_path = config.get_string("ssd_config", params.ssd_config_path);
+    params.dnn_score_threshold = config.get_float("dnn_score_threshold", params.dnn_score_threshold);
+    params.downscale = config.get_int("downscale", params.downscale, 1); // 0 だと縮小の割り算が落ちる
+    int min_face = config.get_int("min_face_size", params.min_size.width, 1);
+    params.min_size = cv::Size(min_face, min_face);
+    params.full_scan_interval = config.get_int("full_scan_interval", params.full_scan_interval);
+    params.refine_at_full_res = config.get_bool("refine_at_full_res", params.refine_at_full_res);
+    params.range_gate = config.get_bool("range_gate", params.range_gate);
+    params.range_gate_min_scale = config.get_float("range_gate_min_scale", params.range_gate_min_scale);
+    params.range_gate_max_scale = config.get_float("range_gate_max_scale", params.range_gate_max_scale);
+    params.range_gate_max_cm = config.get_float("range_gate_max_cm", params.range_gate_max_cm);
+    params.equalizer.refresh_interval = config.get_int("lut_refresh_interval", params.equalizer.refresh_interval);
+    return params;
+}
+
+PanTiltParams pan_tilt_params(const Config& config) {
+    PanTiltParams params;
+    params.frame_center = cv::Point(CAMERA_WIDTH / 2, CAMERA_HEIGHT / 2);
+    params.pulse_per_pixel_pan = config.get_float("pulse_per_pixel_pan", params.pulse_per_pixel_pan);
+    params.pulse_per_pixel_tilt = config.get_float("pulse_per_pixel_tilt", params.pulse_per_pixel_tilt);
+    params.kp = config.get_float("kp", params.kp);
+    params.ki = config.get_float("ki", params.ki);
+    params.kd = config.get_float("kd", params.kd);
+    params.max_speed = config.get_float("max_speed", params.max_speed);
+    params.dead_zone = config.get_int("dead_zone", params.dead_zone);
+    return params;
+}
+
+ServoOutputParams servo_output_params(const Config& config) {
+    ServoOutputParams params;
+    params.pan.pin = PAN_SERVO_PIN;
+    params.tilt.pin = TILT_SERVO_PIN;
+    params.pan = servo_axis_params(config, "pan", params.pan);
+    params.tilt = servo_axis_params(config, "tilt", params.tilt);
+    params.max_slew = config.get_float("servo_max_slew", params.max_slew);
+    return params;
+}
+
+UltrasonicParams ultrasonic_params(const Config& config) {
+    UltrasonicParams params;
+    params.trig_pin = config.get_int("trig_pin", TRIG_PIN);
+    params.echo_pin = config.get_int("echo_pin", ECHO_PIN);
+    params.ping_interval_ms = config.get_int("ping_interval_ms", params.ping_interval_ms);
+    params.quiet_time_ms = config.get_int("quiet_time_ms", params.quiet_time_ms);
+    params.max_distance_cm = config.get_float("max_distance_cm", params.max_distance_cm);
+    params.calibration.table_path = config.get_string("calibration_table", params.calibration.table_path);
+    params.calibration.soc_offset = config.get_float("soc_temperature_offset", params.calibration.soc_offset);
+    params.filter.window = config.get_int("range_filter_window", static_cast<int>(params.filter.window));
+    params.filter.ema_alpha = config.get_float("range_filter_alpha", params.filter.ema_alpha);
+    return params;
+}
+
+WarningParams warning_params(const Config& config) {
+    WarningParams params;
+    params.led_pin = config.get_int("led_pin", params.led_pin);
+    params.distance_cm = config.get_float("warning_distance_cm", params.distance_cm);
+    params.hysteresis_cm = config.get_float("warning_hysteresis_cm", params.hysteresis_cm);
+    return params;
+}
+
+ProximityWakeParams proximity_wake_params(const Config& config) {
+    ProximityWakeParams params;
+    params.enabled = config.get_bool("proximity_wake", params.enabled);
+    params.max_distance_cm = config.get_float("wake_distance_cm", params.max_distance_cm);
+    params.approach_cm = config.get_float("wake_approach_cm", params.approach_cm);
+    return params;
+}
+
+MetricsParams metrics_params(const Config& config) {
+    MetricsParams params;
+    params.port = config.get_int("metrics_port", params.port);
+    params.address = config.get_string("metrics_address", params.address);
+    return params;
+}
+
+PreviewParams preview_params(const Config& config) {
+    PreviewParams params;
+    params.port = config.get_int("preview_port", params.port);
+    params.address = config.get_string("preview_address", params.address);
+    params.width = config.get_int("preview_width", params.width);
+    params.fps = config.get_int("preview_fps", params.fps);
+    params.min_fps = config.get_int("preview_min_fps", params.min_fps);
+    params.max_clients = config.get_int("preview_max_clients", params.max_clients);
+    params.jpeg_quality = config.get_int("preview_quality", params.jpeg_quality);
+    params.encoder = config.get_string("preview_encoder", params.encoder);
+    params.encoder_device = config.get_string("preview_encoder_device", params.encoder_device);
+    return params;
+}
+
+void warn_unknown_keys(const Config& config) {
+    // 全部の XxxParams を一度作れば、どれかが読むキーは使われたことになる (値の WARNING もここで1回だけ出る)
+    face_detector_params(config);
+    pan_tilt_params(config);
+    servo_output_params(config);
+    ultrasonic_params(config);
+    warning_params(config);
+    proximity_wake_params(config);
+    metrics_params(config);
+    preview_params(config);
+    for (const char* key : {"gpio", "camera", "camera_device"}) config.get_string(key, ""); // モードが直接読むキー
+    for (const std::string& key : config.unused_keys()) {
+        std::cerr << "WARNING: Unknown config key [" << key << "] (ignored)\n";
+    }
+}
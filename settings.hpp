@@ -0,0 +1,44 @@
+#pragma once
+// 3つのモード (track, range-only, bench) で共通の配線・カメラの設定と、設定ファイル (config.hpp) から
+// 各部の XxxParams を作る関数
+//
+// 既定値は各 XxxParams の値 (とここの定数) で、設定ファイルに書いたキーだけを上書きする。
+// キーの一覧と例は ras_eye.conf を参照。
+
+#include "config.hpp"
+#include "face_detector.hpp"
+#include "metrics.hpp"
+#include "pan_tilt.hpp"
+#include "preview.hpp"
+#include "servo_output.hpp"
+#include "ultrasonic.hpp"
+
+// --- 配線 (GPIO番号, 要確認) ---
+const int PAN_SERVO_PIN = 17;   // パン用サーボモーター
+const int TILT_SERVO_PIN = 18;  // チルト用サーボモーター
+const int TRIG_PIN = 23;        // 超音波センサーのTrig
+const int ECHO_PIN = 24;        // 超音波センサーのEcho
+const int LED_PIN = 27;         // 警告用LED
+
+// --- カメラ設定 (bench も録画をこの解像度に揃えて流す) ---
+const int CAMERA_WIDTH = 640;
+const int CAMERA_HEIGHT = 480;
+
+// 近すぎる警告の設定 (要調整)
+struct WarningParams {
+    int led_pin = LED_PIN;
+    float distance_cm = 40.0f;   // 警告を発する距離のしきい値 (cm)
+    float hysteresis_cm = 5.0f;  // 警告を消すのはしきい値よりこれだけ遠くなってから (cm)
+};
+
+FaceDetectorParams face_detector_params(const Config& config);
+PanTiltParams pan_tilt_params(const Config& config);
+ServoOutputParams servo_output_params(const Config& config);
+UltrasonicParams ultrasonic_params(const Config& config);
+WarningParams warning_params(const Config& config);
+ProximityWakeParams proximity_wake_params(const Config& config);
+MetricsParams metrics_params(const Config& config);
+PreviewParams preview_params(const Config& config);
+
+// 設定ファイルのキーのうち、どのモードも読まないもの (綴りの間違い) に WARNING を出す
+void warn_unknown_keys(const Config& config);
@@ -0,0 +1,129 @@
+#include "stage_stats.hpp"
+
+#include <cmath>
+#include <iomanip>
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::Capture: return "capture";
+    case Stage::Motion: return "motion";
+    case Stage::Preprocess: return "preprocess";
+    case Stage::Detect: return "detect";
+    case Stage::Landmark: return "landmark";
+    case Stage::Servo: return "servo";
+    case Stage::Ranging: return "ranging";
+    case Stage::Pipeline: return "pipeline";
+    default: return "?";
+    }
+}
+
+// 0-7us はそのままビン番号、それ以上は (2の指数, 上位3ビット) からビン番号を決める
+int LatencyHistogram::bin_of(uint32_t us) {
+    if (us < SUB_BINS) return static_cast<int>(us);
+    int exponent = 31 - __builtin_clz(us); // 3 以上
+    int mantissa = static_cast<int>((us >> (exponent - 3)) & (SUB_BINS - 1));
+    int bin = (exponent - 2) * SUB_BINS + mantissa;
+    return bin < BIN_COUNT ? bin : BIN_COUNT - 1;
+}
+
+// そのビンに入る最大の値
+uint32_t LatencyHistogram::bin_upper(int bin) {
+    if (bin < SUB_BINS) return static_cast<uint32_t>(bin);
+    int exponent = bin / SUB_BINS + 2;
+    int mantissa = bin % SUB_BINS;
+    uint64_t lower = (static_cast<uint64_t>(SUB_BINS + mantissa)) << (exponent - 3);
+    uint64_t width = 1ull << (exponent - 3);
+    uint64_t upper = lower + width - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(upper);
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    m_bins[bin_of(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum_us.fetch_add(us, std::memory_order_relaxed);
+    uint32_t prev = m_max_us.load(std::memory_order_relaxed);
+    while (us > prev && !m_max_us.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::take() {
+    Snapshot snapshot;
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        snapshot.bins[i] = m_bins[i].exchange(0, std::memory_order_relaxed);
+    }
+    snapshot.count = m_count.exchange(0, std::memory_order_relaxed);
+    snapshot.sum_us = m_sum_us.exchange(0, std::memory_order_relaxed);
+    snapshot.max_us = m_max_us.exchange(0, std::memory_order_relaxed);
+    return snapshot;
+}
+
+double LatencyHistogram::Snapshot::percentile(double p) const {
+    // record() と take() が並行すると count とビンの合計がずれることがあるので、ビンの合計を使う
+    uint64_t total = 0;
+    for (uint32_t n : bins) total += n;
+    if (total == 0) return 0.0;
+
+    uint64_t target = static_cast<uint64_t>(std::ceil(p * total));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        seen += bins[i];
+        if (seen >= target) {
+            uint32_t upper = bin_upper(i);
+            return upper < max_us ? upper : max_us;
+        }
+    }
+    return max_us;
+}
+
+// 0.1ms から 10s まで (検出の時間も見失ってから見つけ直すまでの時間も入る)
+const std::array<uint32_t, CumulativeHistogram::BUCKET_COUNT> CumulativeHistogram::BOUNDS_US = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+void CumulativeHistogram::record(uint32_t us) {
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT && us > BOUNDS_US[bucket]) ++bucket;
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+CumulativeHistogram::Snapshot CumulativeHistogram::snapshot() const {
+    Snapshot snapshot;
+    for (int i = 0; i <= BUCKET_COUNT; ++i) snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.sum_us = m_sum_us.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+StageStats::StageStats() : m_window_start(Clock::now()) {}
+
+void StageStats::record(Stage stage, Clock::duration elapsed) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    record_us(stage, us < 0 ? 0 : static_cast<uint32_t>(us));
+}
+
+void StageStats::record_us(Stage stage, uint32_t us) {
+    m_histograms[static_cast<int>(stage)].record(us);
+    m_cumulative[static_cast<int>(stage)].record(us);
+}
+
+void StageStats::report(std::ostream& out) {
+    Clock::time_point now = Clock::now();
+    double window_s = std::chrono::duration<double>(now - m_window_start).count();
+    m_window_start = now;
+
+    out << "--- stats (" << std::fixed << std::setprecision(1) << window_s << " s) ---\n";
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        LatencyHistogram::Snapshot snapshot = m_histograms[i].take();
+        double rate = window_s > 0.0 ? snapshot.count / window_s : 0.0;
+        out << std::left << std::setw(11) << stage_name(static_cast<Stage>(i)) << std::right
+            << std::setprecision(1) << std::setw(6) << rate << "/s"
+            << std::setprecision(2)
+            << "  p50=" << std::setw(7) << snapshot.percentile(0.50) / 1000.0
+            << "  p95=" << std::setw(7) << snapshot.percentile(0.95) / 1000.0
+            << "  p99=" << std::setw(7) << snapshot.percentile(0.99) / 1000.0
+            << "  max=" << std::setw(7) << snapshot.max_us / 1000.0 << " ms\n";
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+// 処理段ごとの所要時間の計測
+//
+// 各段の所要時間を対数目盛りのヒストグラム (atomic のカウンタの配列) に記録する。
+// record() はロックを取らず fetch_add するだけなので、どのスレッドから呼んでもよい。
+// take() でその時点までの分布を取り出してリセットし、p50/p95/p99 を計算する。
+// それとは別に、リセットしない粗いヒストグラム (CumulativeHistogram) にも数える (metrics.hpp で外に出す用)。
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// 計測する処理段
+enum class Stage : int {
+    Capture,     // カメラからの取得 (待ち時間を含む)
+    Motion,      // 動き検出 (サムネイルの差分)
+    Preprocess,  // グレースケール化・縮小・ヒストグラム平坦化
+    Detect,      // 顔検出エンジン (detectMultiScale など)
+    Landmark,    // 顔の切り出し内での鼻の位置 (特徴点) 推定
+    Servo,       // サーボ制御1周期
+    Ranging,     // 超音波: トリガーから結果が出るまで
+    Pipeline,    // フレーム取得から制御の目標更新まで
+    Count
+};
+
+const char* stage_name(Stage stage);
+
+// 対数目盛りのヒストグラム (単位: us)
+// 1オクターブを8分割するので、パーセンタイルの誤差は最大 12.5% 程度
+class LatencyHistogram {
+public:
+    static const int SUB_BINS = 8;
+    static const int BIN_COUNT = (32 - 2) * SUB_BINS;
+
+    // ある時点までの分布
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint32_t max_us = 0;
+        std::array<uint32_t, BIN_COUNT> bins{};
+
+        // p (0-1) パーセンタイルの値 (us)。サンプルが無ければ 0
+        double percentile(double p) const;
+        double mean_us() const { return count ? static_cast<double>(sum_us) / count : 0.0; }
+    };
+
+    void record(uint32_t us);
+    // 現在までの分布を取り出してゼロに戻す
+    Snapshot take();
+
+    static int bin_of(uint32_t us);
+    static uint32_t bin_upper(int bin);
+
+private:
+    std::array<std::atomic<uint32_t>, BIN_COUNT> m_bins{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum_us{0};
+    std::atomic<uint32_t> m_max_us{0};
+};
+
+// リセットしない累積のヒストグラム (単位: us, バケツは BOUNDS_US の固定)
+// Prometheus のヒストグラム (バケツごとの累積の数・合計・回数) としてそのまま出せる。record() は fetch_add だけ
+class CumulativeHistogram {
+public:
+    static const int BUCKET_COUNT = 16;
+    static const std::array<uint32_t, BUCKET_COUNT> BOUNDS_US; // 各バケツの上限 (この値以下。最後の上に +Inf)
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT + 1> buckets{}; // バケツごとの数 (累積ではない。最後は +Inf)
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+    };
+
+    void record(uint32_t us);
+    // 今までの分布 (リセットしない。他のスレッドから読んでよい)
+    Snapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT + 1> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum_us{0};
+};
+
+// 全処理段のヒストグラム
+class StageStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StageStats();
+
+    void record(Stage stage, Clock::duration elapsed);
+    void record_us(Stage stage, uint32_t us);
+
+    // 前回の report() からの分布と fps を書き出し、計測をリセットする
+    void report(std::ostream& out);
+
+    // 起動してからの分布 (report() でリセットされない。他のスレッドから読んでよい)
+    CumulativeHistogram::Snapshot cumulative(Stage stage) const { return m_cumulative[static_cast<int>(stage)].snapshot(); }
+
+private:
+    std::array<LatencyHistogram, static_cast<int>(Stage::Count)> m_histograms;
+    std::array<CumulativeHistogram, static_cast<int>(Stage::Count)> m_cumulative;
+    Clock::time_point m_window_start;
+};
+
+// スコープを抜けるまでの時間を記録する (stats が nullptr なら何もしない)
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(StageStats* stats, Stage stage)
+        : m_stats(stats), m_stage(stage), m_start(StageStats::Clock::now()) {}
+    ~ScopedStageTimer() {
+        if (m_stats) m_stats->record(m_stage, StageStats::Clock::now() - m_start);
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    StageStats* m_stats;
+    Stage m_stage;
+    StageStats::Clock::time_point m_start;
+};
@@ -0,0 +1,82 @@
+#include "target_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int STATE_SIZE = 6;       // cx, cy, w, vx, vy, vw
+const int MEASUREMENT_SIZE = 3; // cx, cy, w
+
+}
+
+TargetFilter::TargetFilter(const TargetFilterParams& params)
+    : m_params(params), m_kalman(STATE_SIZE, MEASUREMENT_SIZE, 0, CV_32F),
+      m_measurement(MEASUREMENT_SIZE, 1, CV_32F) {
+    // 位置・サイズだけを観測する
+    m_kalman.measurementMatrix = cv::Mat::zeros(MEASUREMENT_SIZE, STATE_SIZE, CV_32F);
+    for (int i = 0; i < MEASUREMENT_SIZE; ++i) m_kalman.measurementMatrix.at<float>(i, i) = 1.0f;
+
+    m_kalman.measurementNoiseCov = cv::Mat::zeros(MEASUREMENT_SIZE, MEASUREMENT_SIZE, CV_32F);
+    m_kalman.measurementNoiseCov.at<float>(0, 0) = params.position_noise * params.position_noise;
+    m_kalman.measurementNoiseCov.at<float>(1, 1) = params.position_noise * params.position_noise;
+    m_kalman.measurementNoiseCov.at<float>(2, 2) = params.size_noise * params.size_noise;
+
+    m_kalman.transitionMatrix = cv::Mat::eye(STATE_SIZE, STATE_SIZE, CV_32F);
+    m_kalman.processNoiseCov = cv::Mat::zeros(STATE_SIZE, STATE_SIZE, CV_32F);
+}
+
+void TargetFilter::reset(const cv::Rect& face, Clock::time_point stamp) {
+    m_kalman.statePost = cv::Mat::zeros(STATE_SIZE, 1, CV_32F);
+    m_kalman.statePost.at<float>(0) = face.x + face.width * 0.5f;
+    m_kalman.statePost.at<float>(1) = face.y + face.height * 0.5f;
+    m_kalman.statePost.at<float>(2) = static_cast<float>(face.width);
+
+    // 位置は検出と同じくらい確か、速度はまったく分からない
+    m_kalman.errorCovPost = cv::Mat::zeros(STATE_SIZE, STATE_SIZE, CV_32F);
+    for (int i = 0; i < MEASUREMENT_SIZE; ++i) {
+        m_kalman.errorCovPost.at<float>(i, i) = m_kalman.measurementNoiseCov.at<float>(i, i);
+        m_kalman.errorCovPost.at<float>(i + 3, i + 3) = m_params.initial_velocity * m_params.initial_velocity;
+    }
+
+    m_aspect = face.width > 0 ? static_cast<float>(face.height) / face.width : 1.0f;
+    m_stamp = stamp;
+    m_initialized = true;
+}
+
+cv::Rect TargetFilter::predict(Clock::time_point stamp) {
+    float dt = std::chrono::duration<float>(stamp - m_stamp).count();
+    if (dt < 0.0f) dt = 0.0f;
+    m_stamp = stamp;
+
+    // 等速モデル: 位置 += 速度 * dt。加速度を白色雑音として processNoiseCov を dt から作る
+    float dt2 = dt * dt;
+    for (int i = 0; i < MEASUREMENT_SIZE; ++i) {
+        float accel = i < 2 ? m_params.position_accel : m_params.size_accel;
+        float a2 = accel * accel;
+        m_kalman.transitionMatrix.at<float>(i, i + 3) = dt;
+        m_kalman.processNoiseCov.at<float>(i, i) = dt2 * dt2 / 4.0f * a2;
+        m_kalman.processNoiseCov.at<float>(i, i + 3) = dt2 * dt / 2.0f * a2;
+        m_kalman.processNoiseCov.at<float>(i + 3, i) = dt2 * dt / 2.0f * a2;
+        m_kalman.processNoiseCov.at<float>(i + 3, i + 3) = dt2 * a2;
+    }
+
+    // (predict() は statePost も予測値で上書きするので、続けて見失っても予測を重ねていける)
+    return state_rect(m_kalman.predict());
+}
+
+void TargetFilter::correct(const cv::Rect& face) {
+    m_measurement.at<float>(0) = face.x + face.width * 0.5f;
+    m_measurement.at<float>(1) = face.y + face.height * 0.5f;
+    m_measurement.at<float>(2) = static_cast<float>(face.width);
+    m_kalman.correct(m_measurement);
+    if (face.width > 0) m_aspect = static_cast<float>(face.height) / face.width;
+}
+
+cv::Rect TargetFilter::state_rect(const cv::Mat& state) const {
+    float width = std::max(state.at<float>(2), 1.0f);
+    float height = width * m_aspect;
+    return cv::Rect(static_cast<int>(std::lround(state.at<float>(0) - width * 0.5f)),
+                    static_cast<int>(std::lround(state.at<float>(1) - height * 0.5f)),
+                    static_cast<int>(std::lround(width)), static_cast<int>(std::lround(height)));
+}
@@ -0,0 +1,49 @@
+#pragma once
+// 顔の位置とサイズのカルマンフィルタ (等速モデル)
+//
+// 状態は [中心x, 中心y, 幅, 速度x, 速度y, 幅の変化速度] (フレーム座標, 秒単位)。
+// 検出できたフレームで correct() し、見失ったフレームでは predict() の結果で顔の位置を推定する。
+// フレームの時刻から経過時間を求めるので、検出が何フレームか飛んでも速度の推定は崩れない。
+// (画面上の動きだけを見るので、カメラ自身の動きは目標の動きとして扱われる)
+
+#include <chrono>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video.hpp>
+
+// フィルタの調整値 (要調整, 単位はピクセル)
+struct TargetFilterParams {
+    float position_noise = 4.0f;      // 検出位置のばらつき (標準偏差)
+    float size_noise = 4.0f;          // 検出サイズのばらつき
+    float position_accel = 600.0f;    // 目標の加速度の大きさ (px/s^2, 大きいほど検出に素早く追従する)
+    float size_accel = 100.0f;        // サイズ変化の加速度の大きさ (px/s^2)
+    float initial_velocity = 200.0f;  // 最初の速度の不確かさ (px/s)
+};
+
+class TargetFilter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TargetFilter(const TargetFilterParams& params = TargetFilterParams());
+
+    // face から推定をやり直す
+    void reset(const cv::Rect& face, Clock::time_point stamp);
+    // 推定を捨てる (initialized() が false になる)
+    void clear() { m_initialized = false; }
+    bool initialized() const { return m_initialized; }
+
+    // stamp の時点の顔を予測する (状態も stamp まで進める)
+    cv::Rect predict(Clock::time_point stamp);
+    // predict() した時点で検出できた face で推定を補正する
+    void correct(const cv::Rect& face);
+
+private:
+    cv::Rect state_rect(const cv::Mat& state) const;
+
+    TargetFilterParams m_params;
+    cv::KalmanFilter m_kalman;
+    cv::Mat m_measurement;
+    bool m_initialized = false;
+    Clock::time_point m_stamp; // 状態の時点
+    float m_aspect = 1.0f;     // 高さ / 幅 (最後に検出した顔のもの)
+};
@@ -0,0 +1,191 @@
+#include "ultrasonic.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// HC-SR04 のトリガーに必要な High の幅 (データシートでは 10us 以上)
+const unsigned TRIGGER_PULSE_US = 10;
+
+}
+
+const char* range_status_name(RangeStatus status) {
+    switch (status) {
+    case RangeStatus::None: return "none";
+    case RangeStatus::Ok: return "ok";
+    case RangeStatus::NoEcho: return "no_echo";
+    case RangeStatus::EchoStuck: return "echo_stuck";
+    case RangeStatus::OutOfRange: return "out_of_range";
+    default: return "?";
+    }
+}
+
+UltrasonicRanger::UltrasonicRanger(const UltrasonicParams& params) : m_params(params), m_filter(params.filter), m_converter(params.calibration) {}
+
+UltrasonicRanger::~UltrasonicRanger() {
+    stop();
+}
+
+bool UltrasonicRanger::start(GpioDevice& gpio) {
+    if (m_started) return true;
+    if (!m_converter.load()) return false;
+    m_gpio = &gpio;
+
+    update_echo_timeout();
+    if (m_gpio->set_mode(m_params.trig_pin, GpioMode::Output) < 0) return false;
+    if (m_gpio->set_mode(m_params.echo_pin, GpioMode::Input) < 0) return false;
+    m_gpio->write(m_params.trig_pin, 0);
+
+    // Echo の両エッジと、変化が無いまま echo_timeout_ms() 経ったとき (GPIO_LEVEL_TIMEOUT) に呼ばれる
+    if (m_gpio->set_alert_func(m_params.echo_pin, on_echo, this) < 0) return false;
+    m_gpio->set_watchdog(m_params.echo_pin, m_echo_timeout_ms.load());
+
+    if (m_gpio->set_timer_func(m_params.timer_id, m_params.timer_tick_ms, on_timer, this) < 0) {
+        m_gpio->set_watchdog(m_params.echo_pin, 0);
+        m_gpio->set_alert_func(m_params.echo_pin, nullptr, nullptr);
+        return false;
+    }
+    m_started = true;
+    return true;
+}
+
+void UltrasonicRanger::stop() {
+    if (!m_started) return;
+    m_gpio->set_timer_func(m_params.timer_id, m_params.timer_tick_ms, nullptr, nullptr);
+    m_gpio->set_watchdog(m_params.echo_pin, 0);
+    m_gpio->set_alert_func(m_params.echo_pin, nullptr, nullptr);
+    m_started = false;
+}
+
+void UltrasonicRanger::set_air_temperature(float celsius) {
+    m_converter.set_temperature(celsius);
+    if (!m_started) return; // start() で決める
+    unsigned before = m_echo_timeout_ms.load();
+    update_echo_timeout();
+    if (m_echo_timeout_ms.load() != before) m_gpio->set_watchdog(m_params.echo_pin, m_echo_timeout_ms.load());
+}
+
+// 最大距離の往復にかかる時間 (今の音速) だけ Echo を待つ (ウォッチドッグは ms 単位なので切り上げる)
+void UltrasonicRanger::update_echo_timeout() {
+    uint32_t max_echo_us = static_cast<uint32_t>(m_converter.to_echo_us(m_params.max_distance_cm) * m_params.echo_margin);
+    m_max_echo_us.store(max_echo_us, std::memory_order_relaxed);
+    m_echo_timeout_ms.store(std::max(1u, (max_echo_us + 999) / 1000), std::memory_order_relaxed);
+}
+
+unsigned UltrasonicRanger::cycle_ms() const {
+    return std::max(m_params.ping_interval_ms, m_params.min_cycle_ms);
+}
+
+RangeReading UltrasonicRanger::latest() const {
+    RangeReading reading;
+    uint32_t before, after;
+    do {
+        before = m_lock_seq.load(std::memory_order_acquire);
+        reading.distance_cm = m_distance_cm.load(std::memory_order_relaxed);
+        reading.status = static_cast<RangeStatus>(m_status.load(std::memory_order_relaxed));
+        reading.tick = m_tick.load(std::memory_order_relaxed);
+        reading.seq = m_reading_seq.load(std::memory_order_relaxed);
+        reading.echo_us = m_echo_us.load(std::memory_order_relaxed);
+        reading.filtered_cm = m_filtered_cm.load(std::memory_order_relaxed);
+        reading.filtered = m_filtered.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = m_lock_seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after); // 書き込み中か、読んでいる間に更新された
+    return reading;
+}
+
+void UltrasonicRanger::on_timer(void* self) {
+    static_cast<UltrasonicRanger*>(self)->fire_trigger();
+}
+
+void UltrasonicRanger::on_echo(int gpio, int level, uint32_t tick, void* self) {
+    static_cast<UltrasonicRanger*>(self)->handle_echo(level, tick);
+}
+
+// GPIO デバイスのタイマースレッドで timer_tick_ms ごとに呼ばれる
+void UltrasonicRanger::fire_trigger() {
+    // 前回の測定がまだ終わっていなければ今回は見送る (結果はウォッチドッグが出す)
+    if (m_waiting_echo.load(std::memory_order_acquire)) return;
+    // 打ち切った後もセンサーは Echo を High にしている。その間のトリガーは受け付けられない
+    if (m_echo_high.load(std::memory_order_acquire)) return;
+
+    uint32_t now = m_gpio->tick();
+    if (now - m_trigger_tick.load(std::memory_order_relaxed) < cycle_ms() * 1000u) return;
+    if (now - m_fall_tick.load(std::memory_order_relaxed) < m_params.quiet_time_ms * 1000u) return;
+
+    m_trigger_tick.store(now, std::memory_order_relaxed);
+    m_waiting_echo.store(true, std::memory_order_release);
+
+    // Trigに10usのHighパルスを送る (幅は GPIO デバイスが作る。pigpio なら DMA なのでここでは待たない)
+    m_gpio->trigger(m_params.trig_pin, TRIGGER_PULSE_US, 1);
+}
+
+// アラート関数を呼ぶスレッド (pigpio ならアラートスレッド) で呼ばれる
+void UltrasonicRanger::handle_echo(int level, uint32_t tick) {
+    if (level == 1) { // 立ち上がり = 超音波を送信した
+        m_rise_tick = tick;
+        m_aborted = false;
+        m_stuck_reported = false;
+        m_echo_high.store(true, std::memory_order_release);
+        return;
+    }
+
+    if (level == 0) { // 立ち下がり = 反射波を受信した (か、センサーが待つのをやめた)
+        if (!m_echo_high.load(std::memory_order_relaxed)) return; // 立ち上がりを見ていないパルスは無視
+        m_fall_tick.store(tick, std::memory_order_relaxed);
+        m_echo_high.store(false, std::memory_order_release);
+        if (m_aborted) return; // 結果はもう出した
+
+        uint32_t pulse_us = tick - m_rise_tick; // tick の桁あふれも符号なし減算で吸収
+        float distance_cm = m_converter.to_cm(pulse_us);
+        if (pulse_us > m_max_echo_us.load(std::memory_order_relaxed) || distance_cm > m_params.max_distance_cm) {
+            publish(0.0f, RangeStatus::OutOfRange, tick);
+        } else {
+            publish(distance_cm, RangeStatus::Ok, tick, pulse_us);
+        }
+        return;
+    }
+
+    // GPIO_LEVEL_TIMEOUT: Echo が echo_timeout_ms() の間変化しなかった
+    if (m_echo_high.load(std::memory_order_relaxed)) {
+        if (!m_aborted) {
+            // 最大距離の往復の時間を過ぎても戻ってこない。立ち下がりを待たずに範囲外とする
+            m_aborted = true;
+            publish(0.0f, RangeStatus::OutOfRange, tick);
+        } else if (!m_stuck_reported && tick - m_rise_tick >= m_params.stuck_timeout_ms * 1000u) {
+            m_stuck_reported = true;
+            publish(0.0f, RangeStatus::EchoStuck, tick);
+        }
+        return;
+    }
+    if (!m_waiting_echo.load(std::memory_order_acquire)) return; // 測定待ちでない (ピング間の無音)
+
+    // ウォッチドッグは最後のエッジから数えるので、トリガーからまだ時間が経っていなければ次を待つ
+    uint32_t since_trigger_us = tick - m_trigger_tick.load(std::memory_order_relaxed);
+    if (since_trigger_us < m_echo_timeout_ms.load(std::memory_order_relaxed) * 1000u) return;
+    publish(0.0f, RangeStatus::NoEcho, tick);
+}
+
+void UltrasonicRanger::publish(float distance_cm, RangeStatus status, uint32_t tick, uint32_t echo_us) {
+    if (m_filter.add(distance_cm, status == RangeStatus::Ok, tick)) m_outliers.fetch_add(1, std::memory_order_relaxed);
+    m_results[static_cast<int>(status)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t seq = m_lock_seq.load(std::memory_order_relaxed);
+    m_lock_seq.store(seq + 1, std::memory_order_relaxed); // 奇数 = 書き込み中
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_distance_cm.store(distance_cm, std::memory_order_relaxed);
+    m_status.store(static_cast<uint8_t>(status), std::memory_order_relaxed);
+    m_tick.store(tick, std::memory_order_relaxed);
+    m_reading_seq.store(m_reading_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_echo_us.store(echo_us, std::memory_order_relaxed);
+    m_filtered_cm.store(m_filter.distance_cm(), std::memory_order_relaxed);
+    m_filtered.store(m_filter.valid(), std::memory_order_relaxed);
+
+    m_lock_seq.store(seq + 2, std::memory_order_release);
+
+    if (m_stats) m_stats->record_us(Stage::Ranging, tick - m_trigger_tick.load(std::memory_order_relaxed));
+
+    // 次のトリガーを許可する
+    m_waiting_echo.store(false, std::memory_order_release);
+}
@@ -0,0 +1,148 @@
+#pragma once
+// 超音波センサー (HC-SR04) の非同期測距
+//
+// GPIO デバイスのタイマーで短い間隔ごとにトリガーを出せるか調べ、Echo ピンの立ち上がり/立ち下がりを
+// アラート関数に渡されるタイムスタンプ (pigpio なら gpioTick のハードウェア時刻, us単位) で記録する。
+// 計算した距離はシーケンスロックで公開するので、latest() は待たずにすぐ返る。
+// パルス幅から距離への変換は EchoConverter (range_calibration.hpp) の表を引く (気温で補正した音速・個体ごとの校正表)。
+// Echo を待つ時間は max_distance_cm の往復にかかる時間から決める (4m で約 24ms。気温を変えるたびに決め直す)。それより長いパルスは
+// 立ち下がりを待たずに OutOfRange として打ち切る (HC-SR04 は反射が無いと Echo を 38ms ほど High のままにする)。
+// 次のトリガーは、センサーが Echo を Low に戻してから quiet_time_ms 経ち、前のトリガーから
+// ping_interval の間隔 (センサーの測定周期 min_cycle_ms 以上) が空いてから出す。
+// 結果が出るたびに RangeFilter (range_filter.hpp) にも通し、1回ごとの値とフィルタした値を両方公開する。
+// GpioDevice::initialise() の後で start() を呼ぶこと。
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "gpio_device.hpp"
+#include "range_calibration.hpp"
+#include "range_filter.hpp"
+#include "stage_stats.hpp"
+
+// 測定結果の状態
+enum class RangeStatus : uint8_t {
+    None,        // まだ一度も測定していない
+    Ok,          // 正常
+    NoEcho,      // Echo が High にならなかった (タイムアウト)
+    EchoStuck,   // Echo が Low に戻らなかった (タイムアウト)
+    OutOfRange,  // 測定範囲外 (物理的にありえない値)
+    Count
+};
+
+// 状態の名前 ("ok", "no_echo" など。metrics のラベル用)
+const char* range_status_name(RangeStatus status);
+
+// 1回分の測定結果
+struct RangeReading {
+    float distance_cm = 0.0f;  // この1回の測定値
+    uint32_t echo_us = 0;      // そのときの Echo のパルス幅 (校正表を作るとき用, 正常なときだけ)
+    RangeStatus status = RangeStatus::None;
+    uint32_t tick = 0;  // 結果が出た時刻 (GpioDevice::tick, us)
+    uint32_t seq = 0;   // 測定番号 (新しい結果が出るたびに増える。0 は未測定)
+    float filtered_cm = 0.0f;  // 直近の測定値の中央値 + EMA (filtered が false なら無効)
+    bool filtered = false;
+
+    bool valid() const { return status == RangeStatus::Ok; }
+};
+
+// フィルタした距離 (cm)。しばらく測れていない・未測定なら -1 (どのモードもこの値で判定する)
+inline float filtered_distance_cm(const RangeReading& reading) {
+    return reading.filtered ? reading.filtered_cm : -1.0f;
+}
+
+// 測距の設定値
+struct UltrasonicParams {
+    int trig_pin = 23;
+    int echo_pin = 24;
+    unsigned timer_id = 0;                  // GPIO デバイスのタイマー番号 (0-9)
+    unsigned ping_interval_ms = 0;          // トリガーを出す間隔 (0 = センサーが許す限り速く。min_cycle_ms より短くはしない)
+    unsigned min_cycle_ms = 60;             // センサーの測定周期の下限 (HC-SR04 のデータシートの推奨値)
+    unsigned quiet_time_ms = 10;            // Echo が Low に戻ってから次のトリガーまで待つ時間 (残響が消えるまで, 要調整)
+    unsigned timer_tick_ms = 10;            // トリガーを出せるか調べる間隔 (pigpio のタイマーは 10ms 以上)
+    float max_distance_cm = 400.0f;         // これより遠い値は無効。Echo を待つ時間もここから決める
+    float echo_margin = 1.1f;               // Echo を待つ時間の余裕 (気温を読み直すまでの間の変化・センサーの遅れの分)
+    unsigned stuck_timeout_ms = 200;        // Echo がこの時間 High のままなら故障 (EchoStuck) とする
+    RangeCalibrationParams calibration;     // パルス幅 → 距離の変換 (音速の気温補正・校正表)
+    RangeFilterParams filter;               // 測定値のフィルタ
+};
+
+class UltrasonicRanger {
+public:
+    explicit UltrasonicRanger(const UltrasonicParams& params = UltrasonicParams());
+    ~UltrasonicRanger();
+
+    UltrasonicRanger(const UltrasonicRanger&) = delete;
+    UltrasonicRanger& operator=(const UltrasonicRanger&) = delete;
+
+    // 校正表を読み込み、gpio のピン設定とコールバック登録を行い、測距を開始する。失敗したら false
+    bool start(GpioDevice& gpio);
+    // 測距を止める (コールバックを外す)
+    void stop();
+
+    // 最新の測定結果を返す。ブロックしない
+    RangeReading latest() const;
+
+    // 音速を補正する気温 (℃)。Echo を待つ時間も今の音速で決め直す
+    // 他のスレッドから呼んでよい (気温は read_air_temperature() で読む)
+    void set_air_temperature(float celsius);
+    float air_temperature() const { return m_converter.temperature(); }
+    bool calibrated() const { return m_converter.calibrated(); }
+
+    // フィルタで捨てた外れ値の数 (他のスレッドから読んでよい)
+    uint64_t outliers() const { return m_outliers; }
+    // status の結果を出した回数 (他のスレッドから読んでよい)
+    uint64_t results(RangeStatus status) const { return m_results[static_cast<int>(status)].load(std::memory_order_relaxed); }
+
+    // トリガーから結果が出るまでの時間を stats に記録する (start() の前に呼ぶ)
+    void set_stats(StageStats* stats) { m_stats = stats; }
+
+    // Echo を待つ最大時間 (max_distance_cm から決めたもの, start() の後で有効)
+    unsigned echo_timeout_ms() const { return m_echo_timeout_ms.load(std::memory_order_relaxed); }
+    // 実際にトリガーを出す間隔の下限
+    unsigned cycle_ms() const;
+
+    const UltrasonicParams& params() const { return m_params; }
+
+private:
+    static void on_timer(void* self);
+    static void on_echo(int gpio, int level, uint32_t tick, void* self);
+    void fire_trigger();
+    void handle_echo(int level, uint32_t tick);
+    void publish(float distance_cm, RangeStatus status, uint32_t tick, uint32_t echo_us = 0);
+    void update_echo_timeout();
+
+    UltrasonicParams m_params;
+    GpioDevice* m_gpio = nullptr; // start() から stop() まで
+    bool m_started = false;
+    StageStats* m_stats = nullptr;
+    // 気温を変えたスレッドが書き、アラート関数を呼ぶスレッドが読む
+    std::atomic<unsigned> m_echo_timeout_ms{0}; // ウォッチドッグの時間
+    std::atomic<uint32_t> m_max_echo_us{0};     // max_distance_cm の往復にかかる時間 (余裕込み)
+
+    // Echo の状態 (書くのはアラート関数を呼ぶスレッドだけ。m_echo_high と m_fall_tick はタイマースレッドも読む)
+    std::atomic<bool> m_echo_high{false};
+    std::atomic<uint32_t> m_fall_tick{0}; // 最後に Echo が Low に戻った時刻
+    uint32_t m_rise_tick = 0;
+    bool m_aborted = false;        // 立ち下がりを待たずに結果を出した (次の立ち下がりは結果にしない)
+    bool m_stuck_reported = false;
+    RangeFilter m_filter;
+    EchoConverter m_converter; // start() の後は set_air_temperature() だけが書き換える
+    std::atomic<uint64_t> m_outliers{0};
+    std::array<std::atomic<uint64_t>, static_cast<int>(RangeStatus::Count)> m_results{};
+
+    // トリガー後、結果をまだ出していなければ true (タイマースレッド → アラートスレッド)
+    std::atomic<bool> m_waiting_echo{false};
+    std::atomic<uint32_t> m_trigger_tick{0};
+
+    // シーケンスロックで公開する最新結果 (書き込みはアラート関数を呼ぶスレッドのみ)
+    std::atomic<uint32_t> m_lock_seq{0};  // 奇数のときは書き込み中
+    std::atomic<float> m_distance_cm{0.0f};
+    std::atomic<uint8_t> m_status{static_cast<uint8_t>(RangeStatus::None)};
+    std::atomic<uint32_t> m_tick{0};
+    std::atomic<uint32_t> m_reading_seq{0};
+    std::atomic<uint32_t> m_echo_us{0};
+    std::atomic<float> m_filtered_cm{0.0f};
+    std::atomic<bool> m_filtered{false};
+};
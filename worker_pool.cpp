@@ -0,0 +1,65 @@
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i) m_threads.emplace_back(&WorkerPool::worker_loop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) thread.join();
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (m_threads.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    {
+        // 前回の仕事に遅れて入ったワーカーが抜けるのを待ってから差し替える
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_active == 0; });
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_done = 0;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_done == m_count && m_active == 0; });
+}
+
+void WorkerPool::worker_loop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if (m_stop) return;
+        seen = m_generation;
+        ++m_active;
+        lock.unlock();
+        work();
+        lock.lock();
+        if (--m_active == 0) m_finished.notify_all();
+    }
+}
+
+void WorkerPool::work() {
+    while (true) {
+        size_t i = m_next.fetch_add(1);
+        if (i >= m_count) return;
+        (*m_task)(i);
+        if (m_done.fetch_add(1) + 1 == m_count) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+// 使い回すワーカースレッドの集まり
+//
+// run() で渡した処理を番号 0〜count-1 ごとに空いたスレッドで実行し、すべて終わるまで待つ。
+// 呼び出したスレッド自身も1本として働くので、スレッド数 N のプールで作るスレッドは N-1 本。
+// スレッドは最初に作ったものを使い回す (フレームごとに作ったり壊したりしない)。
+// run() は1つのスレッドからだけ呼ぶこと。
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // threads: 呼び出し側を含めたスレッド数 (1 以下なら run() はその場で順に実行するだけ)
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return m_threads.size() + 1; }
+
+    // task(0), task(1), ..., task(count - 1) を並列に実行して、すべて終わるまで待つ
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    void worker_loop();
+    void work(); // 残っている番号を取って実行する
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;     // 新しい仕事か停止
+    std::condition_variable m_finished; // 仕事が全部終わった
+    bool m_stop = false;
+    uint64_t m_generation = 0; // run() のたびに増える
+    size_t m_active = 0;       // work() を実行中のワーカー数
+
+    const std::function<void(size_t)>* m_task = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next{0};
+    std::atomic<size_t> m_done{0};
+};